@@ -14,7 +14,8 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
-#include <ir/animation.h>
+#include <ir/animator.h>
+#include <ir/clipEditor.h>
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 GLFWwindow* initWindow(const char* title, int width, int height);
@@ -68,20 +69,24 @@ int main() {
 	shader.setVec3("_EyePos", camera.position);
 
 	// Animation
-	ir::Animator animator;
-	animator.clip = new ir::AnimationClip();
-	animator.clip->duration = 7;
-	// -- Default keys
-	animator.clip->positionKeys.push_back(ir::Vec3Key(glm::vec3(0, 0, 0), 0));
-	animator.clip->positionKeys.push_back(ir::Vec3Key(glm::vec3(2, 2, 2), 2));
-	animator.clip->positionKeys.push_back(ir::Vec3Key(glm::vec3(1, 1, 1), 5));
-	animator.clip->positionKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
-	animator.clip->rotationKeys.push_back(ir::Vec3Key(glm::vec3(0, 0, 0), 0));
-	animator.clip->rotationKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
-	animator.clip->scaleKeys.push_back(ir::Vec3Key(glm::vec3(1, 1, 1), 0));
-	animator.clip->scaleKeys.push_back(ir::Vec3Key(glm::vec3(5, 5, 5), 2));
-	animator.clip->scaleKeys.push_back(ir::Vec3Key(glm::vec3(2, 1, 2), 5));
-	animator.clip->scaleKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
+	ir::ClipLibrary clipLibrary;
+	ir::ClipEditor clipEditor(&clipLibrary, "default");
+	// Saved clip if there is one, otherwise the default keys
+	if (!clipEditor.load()) {
+		clipEditor.clip.duration = 7;
+		// -- Default keys
+		clipEditor.clip.positionKeys.push_back(ir::Vec3Key(glm::vec3(0, 0, 0), 0));
+		clipEditor.clip.positionKeys.push_back(ir::Vec3Key(glm::vec3(2, 2, 2), 2));
+		clipEditor.clip.positionKeys.push_back(ir::Vec3Key(glm::vec3(1, 1, 1), 5));
+		clipEditor.clip.positionKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
+		clipEditor.clip.rotationKeys.push_back(ir::Vec3Key(glm::vec3(0, 0, 0), 0));
+		clipEditor.clip.rotationKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
+		clipEditor.clip.scaleKeys.push_back(ir::Vec3Key(glm::vec3(1, 1, 1), 0));
+		clipEditor.clip.scaleKeys.push_back(ir::Vec3Key(glm::vec3(5, 5, 5), 2));
+		clipEditor.clip.scaleKeys.push_back(ir::Vec3Key(glm::vec3(2, 1, 2), 5));
+		clipEditor.clip.scaleKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
+	}
+	ir::Animator animator(clipEditor.publish());
 	animator.isPlaying = true;
 
 	while (!glfwWindowShouldClose(window)) {
@@ -97,9 +102,7 @@ int main() {
 
 		// Animation
 		animator.update(deltaTime);
-		monkeyTransform.position = animator.GetNextValue(animator.clip->positionKeys);
-		monkeyTransform.rotation = animator.GetNextValue(animator.clip->rotationKeys);
-		monkeyTransform.scale = animator.GetNextValue(animator.clip->scaleKeys);
+		animator.sample(monkeyTransform.position, monkeyTransform.rotation, monkeyTransform.scale);
 
 		shader.use();
 		shader.setMat4("_Model", monkeyTransform.modelMatrix());
@@ -134,6 +137,9 @@ int main() {
 		}
 		
 		animator.handleUI();
+		if (clipEditor.handleUI()) {
+			animator.setClip(clipEditor.published);
+		}
 
 
 		ImGui::End();
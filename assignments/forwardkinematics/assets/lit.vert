@@ -1,4 +1,5 @@
 #version 450
+//For FLOAT meshes (see ew::VertexFormat)
 //Vertex attributes
 layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec3 vNormal;
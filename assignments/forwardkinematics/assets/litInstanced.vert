@@ -0,0 +1,27 @@
+#version 450
+//For FLOAT meshes (see ew::VertexFormat), PACKED and QUANTIZED meshes use litInstancedPacked.vert
+//Vertex attributes
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+layout(location = 2) in vec2 vTexCoord;
+//Instance attributes, see ew::Mesh::drawInstanced
+layout(location = 5) in mat4 iModel;
+layout(location = 9) in mat4 iNormalMatrix;
+
+uniform mat4 _ViewProjection;
+
+out Surface{
+	vec3 WorldPos; //Vertex position in world space
+	vec3 WorldNormal; //Vertex normal in world space
+	vec2 TexCoord;
+}vs_out;
+
+void main(){
+	//Transform vertex position to World Space.
+	vec4 worldPos = iModel * vec4(vPos,1.0);
+	vs_out.WorldPos = vec3(worldPos);
+	//Normal matrix is computed once per instance on the CPU
+	vs_out.WorldNormal = mat3(iNormalMatrix) * vNormal;
+	vs_out.TexCoord = vTexCoord;
+	gl_Position = _ViewProjection * worldPos;
+}
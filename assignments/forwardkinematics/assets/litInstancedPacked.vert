@@ -0,0 +1,40 @@
+#version 450
+//litInstanced.vert for PACKED and QUANTIZED meshes (see ew::VertexFormat), FLOAT meshes use litInstanced.vert
+//Vertex attributes
+layout(location = 0) in vec3 vPos; //0 to 1 inside the mesh's bounds if QUANTIZED
+layout(location = 1) in vec2 vNormal; //Octahedral
+layout(location = 2) in vec2 vTexCoord;
+//Instance attributes, see ew::Mesh::drawInstanced
+layout(location = 5) in mat4 iModel;
+layout(location = 9) in mat4 iNormalMatrix;
+
+uniform mat4 _ViewProjection;
+//Bounds of QUANTIZED meshes, (0,0,0) and (1,1,1) for PACKED ones
+uniform vec3 _PositionOffset = vec3(0.0);
+uniform vec3 _PositionScale = vec3(1.0);
+
+out Surface{
+	vec3 WorldPos; //Vertex position in world space
+	vec3 WorldNormal; //Vertex normal in world space
+	vec2 TexCoord;
+}vs_out;
+
+//Unfolds a normal packed by ew::Mesh
+vec3 octahedralDecode(vec2 e){
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0){
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
+void main(){
+	vec3 modelPos = _PositionOffset + vPos * _PositionScale;
+	//Transform vertex position to World Space.
+	vec4 worldPos = iModel * vec4(modelPos,1.0);
+	vs_out.WorldPos = vec3(worldPos);
+	//Normal matrix is computed once per instance on the CPU
+	vs_out.WorldNormal = mat3(iNormalMatrix) * octahedralDecode(vNormal);
+	vs_out.TexCoord = vTexCoord;
+	gl_Position = _ViewProjection * worldPos;
+}
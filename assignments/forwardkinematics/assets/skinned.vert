@@ -0,0 +1,42 @@
+#version 450
+//For skinned meshes, which ew::Mesh always loads as FLOAT (see ew::VertexFormat)
+//Vertex attributes
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+layout(location = 2) in vec2 vTexCoord;
+layout(location = 3) in ivec4 vBoneIds;
+layout(location = 4) in vec4 vBoneWeights;
+
+//Joint matrices of every skinned instance this frame
+layout(std430, binding = 0) readonly buffer JointPalette{
+	mat4 _JointMatrices[];
+};
+
+uniform int _PaletteOffset; //Index of this instance's first joint matrix
+uniform mat4 _Model; 
+uniform mat4 _ViewProjection;
+
+out Surface{
+	vec3 WorldPos; //Vertex position in world space
+	vec3 WorldNormal; //Vertex normal in world space
+	vec2 TexCoord;
+}vs_out;
+
+void main(){
+	//Blend up to 4 joint matrices. Vertices without weights stay in the bind pose.
+	mat4 skin = mat4(1.0);
+	float totalWeight = vBoneWeights.x + vBoneWeights.y + vBoneWeights.z + vBoneWeights.w;
+	if (totalWeight > 0.0){
+		skin = _JointMatrices[_PaletteOffset + vBoneIds.x] * vBoneWeights.x
+			+ _JointMatrices[_PaletteOffset + vBoneIds.y] * vBoneWeights.y
+			+ _JointMatrices[_PaletteOffset + vBoneIds.z] * vBoneWeights.z
+			+ _JointMatrices[_PaletteOffset + vBoneIds.w] * vBoneWeights.w;
+	}
+	mat4 model = _Model * skin;
+	//Transform vertex position to World Space.
+	vs_out.WorldPos = vec3(model * vec4(vPos,1.0));
+	//Transform vertex normal to world space using Normal Matrix
+	vs_out.WorldNormal = transpose(inverse(mat3(model))) * vNormal;
+	vs_out.TexCoord = vTexCoord;
+	gl_Position = _ViewProjection * vec4(vs_out.WorldPos,1.0);
+}
@@ -14,8 +14,10 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
-#include <ir/animation.h>
+#include <ir/animator.h>
+#include <ir/clipEditor.h>
 #include <ir/animHierarchy.h>
+#include <ir/ik.h>
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 GLFWwindow* initWindow(const char* title, int width, int height);
@@ -51,24 +53,30 @@ int main() {
 	glEnable(GL_DEPTH_TEST);
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
-	ew::Model monkeyModel = ew::Model("assets/Suzanne.obj");
+	ew::Shader shader = ew::Shader("assets/litInstancedPacked.vert", "assets/lit.frag");
+	ew::Model monkeyModel = ew::Model("assets/Suzanne.obj", true, ew::VertexFormat::QUANTIZED);
 	ew::Transform monkeyTransform;
+	//One monkey per joint, all drawn in a single instanced call
+	std::vector<glm::mat4> jointModels;
+	std::vector<glm::mat4> jointNormals;
+	ew::InstanceBuffer jointModelBuffer;
+	ew::InstanceBuffer jointNormalBuffer;
 	
 	//Forward kinematics
-	ir::Skeleton skeleton;
-	skeleton.joints.push_back(new ir::Joint("Hips")); // 0
-	skeleton.joints.push_back(new ir::Joint("Torso", skeleton.joints[0])); // 1
-	skeleton.joints.push_back(new ir::Joint("Shoulder_R", skeleton.joints[1])); // 2
-	skeleton.joints.push_back(new ir::Joint("Shoulder_L", skeleton.joints[1])); // 3
-	skeleton.joints.push_back(new ir::Joint("Knee_R", skeleton.joints[0])); // 4
-	skeleton.joints.push_back(new ir::Joint("Knee_L", skeleton.joints[0])); // 5
-	skeleton.joints.push_back(new ir::Joint("Elbow_R", skeleton.joints[2])); // 6
-	skeleton.joints.push_back(new ir::Joint("Elbow_L", skeleton.joints[3])); // 7
-	skeleton.joints.push_back(new ir::Joint("Wrist_R", skeleton.joints[6])); // 8
-	skeleton.joints.push_back(new ir::Joint("Wrist_L", skeleton.joints[7])); // 9
-	skeleton.joints.push_back(new ir::Joint("Ankle_R", skeleton.joints[4])); // 10
-	skeleton.joints.push_back(new ir::Joint("Ankle_L", skeleton.joints[5])); // 11
+	ir::SkeletonBuilder skeletonBuilder;
+	skeletonBuilder.addJoint("Hips"); // 0
+	skeletonBuilder.addJoint("Torso", 0); // 1
+	skeletonBuilder.addJoint("Shoulder_R", 1); // 2
+	skeletonBuilder.addJoint("Shoulder_L", 1); // 3
+	skeletonBuilder.addJoint("Knee_R", 0); // 4
+	skeletonBuilder.addJoint("Knee_L", 0); // 5
+	skeletonBuilder.addJoint("Elbow_R", 2); // 6
+	skeletonBuilder.addJoint("Elbow_L", 3); // 7
+	skeletonBuilder.addJoint("Wrist_R", 6); // 8
+	skeletonBuilder.addJoint("Wrist_L", 7); // 9
+	skeletonBuilder.addJoint("Ankle_R", 4); // 10
+	skeletonBuilder.addJoint("Ankle_L", 5); // 11
+	ir::Skeleton skeleton = skeletonBuilder.build();
 	
 	skeleton.joints[0]->localPose.position = glm::vec3(0, 2, 0);
 	skeleton.joints[1]->localPose.position = glm::vec3(0, 2, 0);
@@ -98,10 +106,21 @@ int main() {
 
 
 
-	ir::solveFK(skeleton);
+	ir::FlatSkeleton flatSkeleton = ir::flatten(skeleton);
+	ir::solveFK(flatSkeleton);
 
 	ir::Joint* selectedJoint = nullptr;
 
+	// Right arm reaching for a target
+	bool armIK = false;
+	ir::TwoBoneIK armChain;
+	armChain.root = flatSkeleton.indexOf(skeleton.joints[2]); // Shoulder_R
+	armChain.mid = flatSkeleton.indexOf(skeleton.joints[6]); // Elbow_R
+	armChain.end = flatSkeleton.indexOf(skeleton.joints[8]); // Wrist_R
+	armChain.target = glm::vec3(3, 3, 1);
+	armChain.pole = glm::vec3(3, 3, -3);
+	armChain.usePole = true;
+
 
 	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
 	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -117,20 +136,24 @@ int main() {
 	shader.setVec3("_EyePos", camera.position);
 
 	// Animation
-	ir::Animator animator;
-	animator.clip = new ir::AnimationClip();
-	animator.clip->duration = 7;
-	// -- Default keys
-	animator.clip->positionKeys.push_back(ir::Vec3Key(glm::vec3(0, 0, 0), 0));
-	animator.clip->positionKeys.push_back(ir::Vec3Key(glm::vec3(2, 2, 2), 2));
-	animator.clip->positionKeys.push_back(ir::Vec3Key(glm::vec3(1, 1, 1), 5));
-	animator.clip->positionKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
-	animator.clip->rotationKeys.push_back(ir::Vec3Key(glm::vec3(0, 0, 0), 0));
-	animator.clip->rotationKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
-	animator.clip->scaleKeys.push_back(ir::Vec3Key(glm::vec3(1, 1, 1), 0));
-	animator.clip->scaleKeys.push_back(ir::Vec3Key(glm::vec3(5, 5, 5), 2));
-	animator.clip->scaleKeys.push_back(ir::Vec3Key(glm::vec3(2, 1, 2), 5));
-	animator.clip->scaleKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
+	ir::ClipLibrary clipLibrary;
+	ir::ClipEditor clipEditor(&clipLibrary, "default");
+	// Saved clip if there is one, otherwise the default keys
+	if (!clipEditor.load()) {
+		clipEditor.clip.duration = 7;
+		// -- Default keys
+		clipEditor.clip.positionKeys.push_back(ir::Vec3Key(glm::vec3(0, 0, 0), 0));
+		clipEditor.clip.positionKeys.push_back(ir::Vec3Key(glm::vec3(2, 2, 2), 2));
+		clipEditor.clip.positionKeys.push_back(ir::Vec3Key(glm::vec3(1, 1, 1), 5));
+		clipEditor.clip.positionKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
+		clipEditor.clip.rotationKeys.push_back(ir::Vec3Key(glm::vec3(0, 0, 0), 0));
+		clipEditor.clip.rotationKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
+		clipEditor.clip.scaleKeys.push_back(ir::Vec3Key(glm::vec3(1, 1, 1), 0));
+		clipEditor.clip.scaleKeys.push_back(ir::Vec3Key(glm::vec3(5, 5, 5), 2));
+		clipEditor.clip.scaleKeys.push_back(ir::Vec3Key(glm::vec3(2, 1, 2), 5));
+		clipEditor.clip.scaleKeys.push_back(ir::Vec3Key(glm::vec3(3, 3, 3), 7));
+	}
+	ir::Animator animator(clipEditor.publish());
 	animator.isPlaying = true;
 
 	while (!glfwWindowShouldClose(window)) {
@@ -146,11 +169,18 @@ int main() {
 
 		// Animation
 		//animator.update(deltaTime);
-		//skeleton.joints[0]->localPose.position = animator.GetNextValue(animator.clip->positionKeys);
-		//skeleton.joints[0]->localPose.rotation = animator.GetNextValue(animator.clip->rotationKeys);
-		//skeleton.joints[0]->localPose.scale = animator.GetNextValue(animator.clip->scaleKeys);
-
-		ir::solveFK(skeleton);
+		//skeleton.joints[0]->localPose.position = animator.samplePosition();
+		//skeleton.joints[0]->localPose.rotation = animator.sampleOrientation();
+		//skeleton.joints[0]->localPose.scale = animator.sampleScale();
+		//flatSkeleton.jointChanged(skeleton.joints[0]);
+
+		// only joints edited since the last frame and their descendants are recomputed
+		ir::solveFK(flatSkeleton);
+		if (armIK) {
+			// marks the shoulder and elbow dirty
+			ir::solveTwoBoneIK(flatSkeleton, &armChain, 1);
+			ir::solveFK(flatSkeleton);
+		}
 
 		shader.use();
 		shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
@@ -158,12 +188,15 @@ int main() {
 		shader.setFloat("_Material.Kd", material.Kd);
 		shader.setFloat("_Material.Ks", material.Ks);
 		shader.setFloat("_Material.Shininess", material.Shininess);
-		for each(ir::Joint * j in skeleton.joints) {
-
-			shader.setMat4("_Model", j->globalMat4);
-			
-			monkeyModel.draw(); //Draws monkey model using current shader
+		jointModels.resize(flatSkeleton.size());
+		jointNormals.resize(flatSkeleton.size());
+		for (int i = 0; i < flatSkeleton.size(); i++) {
+			jointModels[i] = ir::toMat4(flatSkeleton.globalMats[i]);
 		}
+		ew::computeNormalMatrices(jointModels.data(), jointNormals.data(), flatSkeleton.size());
+		jointModelBuffer.upload(jointModels.data(), flatSkeleton.size());
+		jointNormalBuffer.upload(jointNormals.data(), flatSkeleton.size());
+		monkeyModel.drawInstanced(jointModelBuffer, jointNormalBuffer, flatSkeleton.size(), &shader); //Draws a monkey at every joint using current shader
 
 		
 		//shader.setMat4("_Model", monkeyTransform.modelMatrix());
@@ -198,6 +231,9 @@ int main() {
 		}
 
 		animator.handleUI();
+		if (clipEditor.handleUI()) {
+			animator.setClip(clipEditor.published);
+		}
 		if (ImGui::CollapsingHeader("Kinematics")) {
 			skeleton.handleUI();
 		}
@@ -217,7 +253,16 @@ int main() {
 		ImGui::Begin("Kinematics");
 
 		if (selectedJoint != nullptr) {
-			selectedJoint->inspectorUI();
+			if (selectedJoint->inspectorUI()) {
+				flatSkeleton.jointChanged(selectedJoint);
+			}
+		}
+		ImGui::Text("FK joints recomputed: %d", flatSkeleton.recomputedJoints);
+		ImGui::Checkbox("Arm IK", &armIK);
+		if (armIK) {
+			ImGui::DragFloat3("IK Target", &armChain.target.x, 0.1f);
+			ImGui::DragFloat3("IK Pole", &armChain.pole.x, 0.1f);
+			ImGui::Text("IK error: %.3f", armChain.error);
 		}
 
 		ImGui::End();
@@ -0,0 +1,42 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+
+//Timing helpers for the benchmarks executable. Build it in Release, numbers from Debug builds mean nothing.
+namespace bench {
+	//Best wall time of one call to fn in milliseconds, over at least minRuns calls and minSeconds
+	template<typename Function>
+	double measure(Function fn, int minRuns = 5, double minSeconds = 0.25) {
+		typedef std::chrono::high_resolution_clock Clock;
+		double best = 1e30;
+		double total = 0;
+		for (int run = 0; run < minRuns || total < minSeconds * 1000.0; run++) {
+			Clock::time_point start = Clock::now();
+			fn();
+			double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			best = ms < best ? ms : best;
+			total += ms;
+		}
+		return best;
+	}
+
+	//Keeps a result alive so the compiler cannot drop the work that produced it
+	template<typename T>
+	void keep(const T& value) {
+		volatile char byte = *(const volatile char*)&value;
+		(void)byte;
+	}
+
+	inline void header(const char* name) {
+		printf("\n== %s ==\n", name);
+	}
+}
+
+//One function per benchmark, listed in main.cpp
+void benchJobSystem();
+void benchEasing();
+void benchFK();
+void benchSkinning();
+void benchTransform();
+void benchTransformStore();
+void benchSceneGraph();
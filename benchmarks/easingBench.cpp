@@ -0,0 +1,49 @@
+#include "bench.h"
+#include <ir/fastEasing.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+template<int TYPE>
+static void benchType(const std::vector<float>& in, std::vector<float>& reference, std::vector<float>& out) {
+	const int count = (int)in.size();
+	//Runtime table and double precision pow/sin/cos
+	double table = bench::measure([&]() {
+		for (int i = 0; i < count; i++) {
+			reference[i] = ir::ease(in[i], TYPE);
+		}
+	});
+	bench::keep(reference[count / 2]);
+	//One value at a time, type chosen at runtime
+	double single = bench::measure([&]() {
+		for (int i = 0; i < count; i++) {
+			out[i] = ir::easeFast(in[i], TYPE);
+		}
+	});
+	bench::keep(out[count / 2]);
+	//simd::WIDTH values per call, type known at compile time
+	double batched = bench::measure([&]() { ir::easeFast<TYPE>(in.data(), out.data(), count); });
+	bench::keep(out[count / 2]);
+
+	float maxError = 0;
+	for (int i = 0; i < count; i++) {
+		maxError = std::max(maxError, std::fabs(out[i] - reference[i]));
+	}
+	printf("%-16s ir::ease %6.2f ns  easeFast(x, type) %6.2f ns (%5.2fx)  easeFast<TYPE>[] %6.2f ns (%5.2fx)  max error %.1e\n",
+		ir::easingNames[TYPE], table * 1e6 / count, single * 1e6 / count, table / single, batched * 1e6 / count, table / batched, maxError);
+}
+
+//ir::ease against the float SIMD kernels in fastEasing.h, per value eased
+void benchEasing() {
+	const int count = 1 << 20;
+	std::vector<float> in(count);
+	std::vector<float> reference(count);
+	std::vector<float> out(count);
+	for (int i = 0; i < count; i++) {
+		in[i] = (float)i / (count - 1);
+	}
+	benchType<ir::IN_OUT_ELASTIC>(in, reference, out);
+	benchType<ir::IN_SINE>(in, reference, out);
+	benchType<ir::OUT_BACK>(in, reference, out);
+	printf("%d values in [0, 1], simd::WIDTH %d\n", count, ir::simd::WIDTH);
+}
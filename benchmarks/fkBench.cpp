@@ -0,0 +1,78 @@
+#include "bench.h"
+#include <ir/animHierarchy.h>
+#include <thread>
+
+//A 63 joint rig: spine and head, two arms with five fingers each, two legs
+static ir::Skeleton buildRig() {
+	ir::SkeletonBuilder builder;
+	ew::Transform offset;
+	offset.position = glm::vec3(0.0f, 0.2f, 0.0f);
+	offset.rotation = glm::angleAxis(0.1f, glm::vec3(0.0f, 0.0f, 1.0f));
+	int spine = builder.addJoint("hips", -1, offset);
+	for (int i = 0; i < 4; i++) {
+		spine = builder.addJoint(nullptr, spine, offset);
+	}
+	int head = builder.addJoint("neck", spine, offset);
+	builder.addJoint("head", head, offset);
+	for (int side = 0; side < 2; side++) {
+		int arm = spine;
+		for (int i = 0; i < 4; i++) {
+			arm = builder.addJoint(nullptr, arm, offset);
+		}
+		for (int finger = 0; finger < 5; finger++) {
+			int joint = arm;
+			for (int i = 0; i < 4; i++) {
+				joint = builder.addJoint(nullptr, joint, offset);
+			}
+		}
+		int leg = 0;
+		for (int i = 0; i < 4; i++) {
+			leg = builder.addJoint(nullptr, leg, offset);
+		}
+	}
+	return builder.build();
+}
+
+static void benchCrowd(ir::FlatSkeleton& flat, int count) {
+	ir::PoseArena arena(flat, count);
+	for (int i = 0; i < count; i++) {
+		ir::SkeletonPose* pose = arena.create();
+		pose->localPoses[0].translation = glm::vec3((float)i, 0.0f, 0.0f);
+	}
+	const double joints = (double)count * flat.size();
+
+	//One thread, no job system involved
+	double serial = bench::measure([&]() { arena.solve(); });
+	bench::keep(arena.poses[count - 1].globalPoses[flat.size() - 1]);
+	printf("%5d skeletons, %2d thread : %8.3f ms  %7.1f M joints/s  %5.2fx\n", count, 1, serial, joints / serial * 1e-3, 1.0);
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	for (unsigned int threads = 2; threads <= (maxThreads > 2 ? maxThreads : 2); threads++) {
+		ew::JobSystem jobs(threads - 1);
+		double ms = bench::measure([&]() { arena.solve(jobs); });
+		bench::keep(arena.poses[count - 1].globalPoses[flat.size() - 1]);
+		printf("%5d skeletons, %2u threads: %8.3f ms  %7.1f M joints/s  %5.2fx\n", count, threads, ms, joints / ms * 1e-3, serial / ms);
+	}
+}
+
+//Full FK of crowds of one skeleton: the recursive solver per skeleton, then PoseArena on 1 to N threads
+void benchFK() {
+	ir::Skeleton skeleton = buildRig();
+	ir::FlatSkeleton flat = ir::flatten(skeleton);
+	ir::solveFK(flat);
+
+	const int counts[] = { 1000, 10000 };
+	for (int count : counts) {
+		//What animating a crowd cost before, one recursive solveFK per skeleton. This reruns one
+		//skeleton, whose joints stay in cache, so it flatters the recursive solver at 10k.
+		double recursive = bench::measure([&]() {
+			for (int i = 0; i < count; i++) {
+				ir::solveFK(skeleton);
+			}
+		});
+		bench::keep(skeleton.joints.back()->globalMat);
+		printf("%5d skeletons, recursive : %8.3f ms  %7.1f M joints/s\n", count, recursive, (double)count * flat.size() / recursive * 1e-3);
+		benchCrowd(flat, count);
+	}
+	printf("%d joints per skeleton, batches of %d skeletons\n", flat.size(), ir::FK_BATCH_SIZE);
+}
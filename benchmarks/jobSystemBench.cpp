@@ -0,0 +1,32 @@
+#include "bench.h"
+#include <ew/jobSystem.h>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+//parallelFor over the same work with 1 to N threads
+void benchJobSystem() {
+	const int count = 1 << 22;
+	const int batchSize = 4096;
+	std::vector<float> values(count);
+	auto work = [&values](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			float x = (float)i * 1e-4f;
+			values[i] = std::sin(x) * std::cos(x * 0.5f) + std::sqrt(x);
+		}
+	};
+
+	//One thread is the plain loop, no job system involved
+	double serial = bench::measure([&]() { work(0, count); });
+	bench::keep(values[count / 2]);
+	printf("%2d thread : %8.2f ms  %5.2fx\n", 1, serial, 1.0);
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	for (unsigned int threads = 2; threads <= (maxThreads > 2 ? maxThreads : 2); threads++) {
+		ew::JobSystem jobs(threads - 1); //Workers plus the waiting thread
+		double ms = bench::measure([&]() { jobs.wait(jobs.parallelFor(count, batchSize, work)); });
+		bench::keep(values[count / 2]);
+		printf("%2u threads: %8.2f ms  %5.2fx\n", threads, ms, serial / ms);
+	}
+	printf("%d elements, batches of %d\n", count, batchSize);
+}
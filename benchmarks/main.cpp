@@ -0,0 +1,29 @@
+#include "bench.h"
+#include <cstring>
+
+//Runs every benchmark, or only those whose name contains the first argument
+struct Benchmark {
+	const char* name;
+	void (*run)();
+};
+
+static const Benchmark BENCHMARKS[] = {
+	{ "jobSystem", benchJobSystem },
+	{ "easing", benchEasing },
+	{ "fk", benchFK },
+	{ "skinning", benchSkinning },
+	{ "transform", benchTransform },
+	{ "transformStore", benchTransformStore },
+	{ "sceneGraph", benchSceneGraph },
+};
+
+int main(int argc, char** argv) {
+	const char* filter = argc > 1 ? argv[1] : "";
+	for (const Benchmark& benchmark : BENCHMARKS) {
+		if (strstr(benchmark.name, filter) != nullptr) {
+			bench::header(benchmark.name);
+			benchmark.run();
+		}
+	}
+	return 0;
+}
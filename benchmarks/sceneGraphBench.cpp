@@ -0,0 +1,76 @@
+#include "bench.h"
+#include <ew/sceneGraph.h>
+#include <vector>
+
+static ew::Transform offset(int i) {
+	ew::Transform local;
+	local.position = glm::vec3(0.01f * (i % 7), 0.1f, 0.0f);
+	local.rotation = glm::angleAxis(0.001f * (i % 13), glm::vec3(0.0f, 0.0f, 1.0f));
+	return local;
+}
+
+//Every node's parent is the one before it
+static std::vector<ew::NodeId> buildDeep(ew::SceneGraph& graph, int count) {
+	std::vector<ew::NodeId> nodes;
+	ew::NodeId parent = ew::NULL_NODE;
+	for (int i = 0; i < count; i++) {
+		parent = graph.create(parent, offset(i));
+		nodes.push_back(parent);
+	}
+	return nodes;
+}
+
+//Every node's parent is node (i - 1) / 16, so a few levels with 16 children each.
+//Created in breadth first order, so sorting to depth first has real work to do.
+static std::vector<ew::NodeId> buildWide(ew::SceneGraph& graph, int count) {
+	std::vector<ew::NodeId> nodes;
+	for (int i = 0; i < count; i++) {
+		nodes.push_back(graph.create(i == 0 ? ew::NULL_NODE : nodes[(i - 1) / 16], offset(i)));
+	}
+	return nodes;
+}
+
+//changed is the index of the node whose subtree is edited for the partial update
+static void benchTree(const char* name, std::vector<ew::NodeId> (*build)(ew::SceneGraph&, int), int count, int changed) {
+	//First update sorts the storage and computes every world matrix
+	double first = bench::measure([&]() {
+		ew::SceneGraph graph;
+		build(graph, count);
+		graph.update();
+		bench::keep(graph.getWorldMatrices()[count - 1]);
+	}, 3);
+
+	ew::SceneGraph graph;
+	std::vector<ew::NodeId> nodes = build(graph, count);
+	graph.update();
+	//Root changed, so every node is recomputed
+	double all = bench::measure([&]() {
+		graph.editLocal(nodes[0]).position.x += 1e-6f;
+		graph.update();
+	});
+	bench::keep(graph.getWorldMatrix(nodes[count - 1]));
+	int allRecomputed = graph.getNumRecomputed();
+	//Only one subtree changed
+	ew::NodeId some = nodes[changed];
+	double subtree = bench::measure([&]() {
+		graph.editLocal(some).position.x += 1e-6f;
+		graph.update();
+	});
+	bench::keep(graph.getWorldMatrix(nodes[count - 1]));
+	int subtreeRecomputed = graph.getNumRecomputed();
+	//Nothing changed
+	double none = bench::measure([&]() { graph.update(); });
+
+	printf("%-5s %6d nodes  build + first update %8.3f ms\n", name, count, first);
+	printf("      root changed    %8.3f ms  %6.2f ns/node  (%d recomputed)\n", all, all * 1e6 / allRecomputed, allRecomputed);
+	printf("      one subtree     %8.3f ms  (%d recomputed)\n", subtree, subtreeRecomputed);
+	printf("      nothing changed %8.3f ms\n", none);
+}
+
+//SceneGraph::update on a 100k node chain and a 100k node tree with 16 children per node
+void benchSceneGraph() {
+	const int count = 100000;
+	//The last quarter of the chain, and one of the root's 16 subtrees
+	benchTree("deep", buildDeep, count, count * 3 / 4);
+	benchTree("wide", buildWide, count, 5);
+}
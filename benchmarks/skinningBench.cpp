@@ -0,0 +1,45 @@
+#include "bench.h"
+#include <ew/procGen.h>
+#include <ir/skinning.h>
+#include <thread>
+
+//CPU linear blend skinning of a ~260k vertex mesh, 4 bones per vertex, on 1 to N threads
+void benchSkinning() {
+	const int boneCount = 64;
+	ew::MeshData bindPose = ew::createSphere(1.0f, 512);
+	const int vertexCount = (int)bindPose.vertices.size();
+	for (int v = 0; v < vertexCount; v++) {
+		ew::SkinWeights skin;
+		skin.bones = glm::ivec4(v % boneCount, (v / 3) % boneCount, (v / 7) % boneCount, (v / 11) % boneCount);
+		skin.weights = glm::vec4(0.4f, 0.3f, 0.2f, 0.1f);
+		bindPose.skinWeights.push_back(skin);
+	}
+	std::vector<glm::mat4> palette(boneCount);
+	for (int b = 0; b < boneCount; b++) {
+		palette[b] = ir::toMat4(ir::affineTRS(glm::vec3(0.01f * b, 0.0f, -0.02f * b), glm::angleAxis(0.05f * b, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.0f)));
+	}
+	std::vector<ew::Vertex> skinned(vertexCount);
+
+	//One thread, no job system involved
+	double serial = bench::measure([&]() {
+		ir::skinVertices(bindPose.vertices.data(), bindPose.skinWeights.data(), palette.data(), skinned.data(), 0, vertexCount);
+	});
+	bench::keep(skinned[vertexCount / 2]);
+	printf("%2d thread : %8.2f ms  %7.1f M vertices/s  %5.2fx\n", 1, serial, vertexCount / serial * 1e-3, 1.0);
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	for (unsigned int threads = 2; threads <= (maxThreads > 2 ? maxThreads : 2); threads++) {
+		ew::JobSystem jobs(threads - 1);
+		double ms = bench::measure([&]() { ir::skinVertices(jobs, bindPose, palette.data(), skinned.data()); });
+		bench::keep(skinned[vertexCount / 2]);
+		printf("%2u threads: %8.2f ms  %7.1f M vertices/s  %5.2fx\n", threads, ms, vertexCount / ms * 1e-3, serial / ms);
+	}
+#if defined(IR_SIMD_AVX)
+	const char* kernel = "AVX";
+#elif defined(IR_SIMD_SSE)
+	const char* kernel = "SSE";
+#else
+	const char* kernel = "scalar";
+#endif
+	printf("%d vertices, %d bones, %s kernel, batches of %d vertices\n", vertexCount, boneCount, kernel, ir::SKIN_BATCH_SIZE);
+}
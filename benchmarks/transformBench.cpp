@@ -0,0 +1,82 @@
+#include "bench.h"
+#include <ew/transform.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//How Transform built its matrices before composeTRS, two full mat4 products
+static glm::mat4 oldModelMatrix(const ew::Transform& transform) {
+	return glm::translate(glm::mat4(1.0f), transform.position) * glm::mat4_cast(transform.rotation) * glm::scale(glm::mat4(1.0f), transform.scale);
+}
+
+static glm::mat4 oldModelMatrixEuler(const ew::Transform& transform) {
+	return glm::translate(glm::mat4(1.0f), transform.position) * glm::mat4_cast(glm::quat(transform.rotEuler)) * glm::scale(glm::mat4(1.0f), transform.scale);
+}
+
+static float maxDifference(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b) {
+	float difference = 0;
+	for (size_t i = 0; i < a.size(); i++) {
+		for (int c = 0; c < 4; c++) {
+			for (int r = 0; r < 4; r++) {
+				difference = std::max(difference, std::fabs(a[i][c][r] - b[i][c][r]));
+			}
+		}
+	}
+	return difference;
+}
+
+template<typename Function>
+static void benchMatrices(const char* name, const std::vector<ew::Transform>& transforms, std::vector<glm::mat4>& out, Function fn) {
+	double ms = bench::measure([&]() {
+		for (size_t i = 0; i < transforms.size(); i++) {
+			out[i] = fn(transforms[i]);
+		}
+	});
+	bench::keep(out[out.size() / 2]);
+	printf("%-36s %8.3f ms  %6.2f ns/matrix\n", name, ms, ms * 1e6 / transforms.size());
+}
+
+//Transform::modelMatrix and modelMatrixEuler through composeTRS against translate * mat4_cast * scale,
+//then CachedTransform reusing its matrices
+void benchTransform() {
+	const int count = 100000;
+	std::vector<ew::Transform> transforms(count);
+	for (int i = 0; i < count; i++) {
+		float t = (float)i;
+		transforms[i].position = glm::vec3(std::sin(t), std::cos(t * 0.3f), t * 0.001f);
+		transforms[i].rotEuler = glm::vec3(t * 0.01f, t * 0.02f, t * 0.03f);
+		transforms[i].rotation = glm::quat(transforms[i].rotEuler);
+		transforms[i].scale = glm::vec3(1.0f + 0.5f * std::sin(t * 0.1f), 1.0f, 2.0f);
+	}
+	std::vector<glm::mat4> composed(count);
+	std::vector<glm::mat4> old(count);
+
+	benchMatrices("modelMatrix (composeTRS)", transforms, composed, [](const ew::Transform& t) { return t.modelMatrix(); });
+	benchMatrices("translate * mat4_cast * scale", transforms, old, oldModelMatrix);
+	printf("max difference %.1e\n", maxDifference(composed, old));
+	benchMatrices("modelMatrixEuler (composeTRS)", transforms, composed, [](const ew::Transform& t) { return t.modelMatrixEuler(); });
+	benchMatrices("translate * mat4_cast(euler) * scale", transforms, old, oldModelMatrixEuler);
+	printf("max difference %.1e\n", maxDifference(composed, old));
+
+	//CachedTransform when nothing changed between reads, and when every transform moved
+	std::vector<ew::CachedTransform> cached(count);
+	for (int i = 0; i < count; i++) {
+		(ew::Transform&)cached[i] = transforms[i];
+	}
+	double unchanged = bench::measure([&]() {
+		for (int i = 0; i < count; i++) {
+			composed[i] = cached[i].modelMatrixEuler();
+		}
+	});
+	bench::keep(composed[count / 2]);
+	printf("%-36s %8.3f ms  %6.2f ns/matrix\n", "CachedTransform euler, unchanged", unchanged, unchanged * 1e6 / count);
+	double moved = bench::measure([&]() {
+		for (int i = 0; i < count; i++) {
+			cached[i].position.x += 1e-6f;
+			composed[i] = cached[i].modelMatrixEuler();
+		}
+	});
+	bench::keep(composed[count / 2]);
+	printf("%-36s %8.3f ms  %6.2f ns/matrix\n", "CachedTransform euler, moved", moved, moved * 1e6 / count);
+	printf("%d transforms\n", count);
+}
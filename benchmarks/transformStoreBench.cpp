@@ -0,0 +1,57 @@
+#include "bench.h"
+#include <ew/transformStore.h>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+//100k moving objects per frame: move every object, then build every model matrix.
+//Matrices go to a plain array here; in a frame they would go to InstanceBuffer::map().
+void benchTransformStore() {
+	const int count = 100000;
+	std::vector<ew::Transform> transforms(count);
+	ew::TransformStore store(count);
+	for (int i = 0; i < count; i++) {
+		float t = (float)i;
+		transforms[i].position = glm::vec3(std::sin(t), std::cos(t * 0.3f), t * 0.001f);
+		transforms[i].rotation = glm::quat(glm::vec3(t * 0.01f, t * 0.02f, t * 0.03f));
+		transforms[i].scale = glm::vec3(1.0f + 0.5f * std::sin(t * 0.1f), 1.0f, 2.0f);
+		store.add(transforms[i]);
+	}
+	std::vector<glm::mat4> matrices(count);
+	const float dx = 1e-6f;
+
+	//One Transform at a time, as the assignment loops did
+	double aos = bench::measure([&]() {
+		for (int i = 0; i < count; i++) {
+			transforms[i].position.x += dx;
+			matrices[i] = transforms[i].modelMatrix();
+		}
+	});
+	bench::keep(matrices[count / 2]);
+	printf("Transform::modelMatrix     : %8.3f ms  %6.2f ns/object\n", aos, aos * 1e6 / count);
+
+	double soa = bench::measure([&]() {
+		float* x = store.channel(ew::TransformStore::POSITION_X);
+		for (int i = 0; i < count; i++) {
+			x[i] += dx;
+		}
+		store.computeModelMatrices(matrices.data());
+	});
+	bench::keep(matrices[count / 2]);
+	printf("TransformStore, %2d thread : %8.3f ms  %6.2f ns/object  %5.2fx\n", 1, soa, soa * 1e6 / count, aos / soa);
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	for (unsigned int threads = 2; threads <= (maxThreads > 2 ? maxThreads : 2); threads++) {
+		ew::JobSystem jobs(threads - 1);
+		double ms = bench::measure([&]() {
+			float* x = store.channel(ew::TransformStore::POSITION_X);
+			for (int i = 0; i < count; i++) {
+				x[i] += dx;
+			}
+			jobs.wait(store.computeModelMatricesAsync(jobs, matrices.data()));
+		});
+		bench::keep(matrices[count / 2]);
+		printf("TransformStore, %2u threads: %8.3f ms  %6.2f ns/object  %5.2fx\n", threads, ms, ms * 1e6 / count, aos / ms);
+	}
+	printf("%d objects, batches of %d\n", count, ew::TransformStore::BATCH_SIZE);
+}
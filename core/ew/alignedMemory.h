@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+
+namespace ew {
+	//size bytes aligned to alignment (a power of two), throws std::bad_alloc like operator new.
+	//Aligned operator new needs C++17, this builds as C++14 as well. Release with alignedFree.
+	inline void* alignedAlloc(size_t size, size_t alignment) {
+		if (alignment < sizeof(void*)) {
+			alignment = sizeof(void*);
+		}
+		if (size == 0) {
+			size = alignment;
+		}
+		void* memory = nullptr;
+#ifdef _WIN32
+		memory = _aligned_malloc(size, alignment);
+#else
+		if (posix_memalign(&memory, alignment, size) != 0) {
+			memory = nullptr;
+		}
+#endif
+		if (memory == nullptr) {
+			throw std::bad_alloc();
+		}
+		return memory;
+	}
+
+	inline void alignedFree(void* memory) {
+#ifdef _WIN32
+		_aligned_free(memory);
+#else
+		free(memory);
+#endif
+	}
+}
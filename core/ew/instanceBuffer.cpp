@@ -0,0 +1,69 @@
+#include "instanceBuffer.h"
+#include "external/glad.h"
+
+namespace ew {
+	static unsigned int s_nextGeneration = 1; //0 means no buffer, GL objects are only created on one thread
+
+	InstanceBuffer::InstanceBuffer()
+	{
+		glGenBuffers(1, &m_vbo);
+		m_generation = s_nextGeneration++;
+	}
+	InstanceBuffer::~InstanceBuffer()
+	{
+		glDeleteBuffers(1, &m_vbo);
+	}
+	void InstanceBuffer::reserve(int count)
+	{
+		if (count > m_capacity) {
+			//Headroom so a growing instance count doesn't reallocate every frame
+			m_capacity = count + count / 2;
+			glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_capacity, NULL, GL_STREAM_DRAW);
+		}
+	}
+	glm::mat4* InstanceBuffer::map(int count)
+	{
+		m_count = count;
+		if (count <= 0) {
+			return nullptr;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		reserve(count);
+		//Invalidating lets the driver hand out fresh storage instead of waiting for last frame's draws
+		void* data = glMapBufferRange(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * count, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return (glm::mat4*)data;
+	}
+	void InstanceBuffer::unmap()
+	{
+		if (m_count <= 0) {
+			return;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	void InstanceBuffer::upload(const glm::mat4* matrices, int count)
+	{
+		m_count = count;
+		if (count <= 0) {
+			return;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		if (count > m_capacity) {
+			reserve(count);
+		}
+		else {
+			//Orphan last frame's storage rather than wait for draws still reading it
+			glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_capacity, NULL, GL_STREAM_DRAW);
+		}
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * count, matrices);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	void computeNormalMatrices(const glm::mat4* models, glm::mat4* normals, int count)
+	{
+		for (int i = 0; i < count; i++) {
+			normals[i] = glm::mat4(glm::transpose(glm::inverse(glm::mat3(models[i]))));
+		}
+	}
+}
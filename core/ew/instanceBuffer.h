@@ -0,0 +1,34 @@
+#pragma once
+#include <glm/glm.hpp>
+
+namespace ew {
+	//Per-instance matrices in a GL buffer, rewritten every frame.
+	//map() hands out buffer memory that producers (e.g. TransformStore, possibly on worker
+	//threads) write into directly; unmap() on the GL thread before drawing.
+	class InstanceBuffer {
+	public:
+		InstanceBuffer();
+		~InstanceBuffer();
+		InstanceBuffer(const InstanceBuffer&) = delete;
+		InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+		//Room for count matrices, last frame's contents are discarded. Grows the buffer if needed.
+		glm::mat4* map(int count);
+		void unmap();
+		//Copies count matrices in, for data that already lives in memory
+		void upload(const glm::mat4* matrices, int count);
+		inline unsigned int getBuffer()const { return m_vbo; }
+		inline int getCount()const { return m_count; }
+		//Unique per InstanceBuffer ever created. GL reuses the names of deleted buffers,
+		//so this is what tells a VAO's cached attributes they point at a buffer that's gone.
+		inline unsigned int getGeneration()const { return m_generation; }
+	private:
+		void reserve(int count);
+		unsigned int m_vbo = 0;
+		unsigned int m_generation = 0;
+		int m_capacity = 0;
+		int m_count = 0;
+	};
+
+	//transpose(inverse(mat3(model))) of each model matrix, for lighting instanced meshes
+	void computeNormalMatrices(const glm::mat4* models, glm::mat4* normals, int count);
+}
@@ -0,0 +1,210 @@
+#include "jobSystem.h"
+#include <algorithm>
+#include <cassert>
+
+namespace ew {
+	//Which system and queue the current thread works for
+	static thread_local const JobSystem* t_jobSystem = nullptr;
+	static thread_local int t_queueIndex = -1;
+	//System whose job the current thread is running, if any
+	static thread_local const JobSystem* t_runningJobOf = nullptr;
+
+	JobSystem::JobSystem(unsigned int numWorkers)
+	{
+		if (numWorkers == 0) {
+			unsigned int hardwareThreads = std::thread::hardware_concurrency();
+			numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+		for (unsigned int i = 0; i < numWorkers + 1; i++)
+		{
+			m_queues.push_back(std::make_unique<WorkQueue>());
+		}
+		for (unsigned int i = 0; i < numWorkers; i++)
+		{
+			m_workers.emplace_back(&JobSystem::workerLoop, this, (int)i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		waitAll();
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_quit = true;
+		}
+		m_wake.notify_all();
+		for (size_t i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i].join();
+		}
+	}
+
+	JobHandle JobSystem::schedule(std::function<void()> job, const JobHandle& dependency)
+	{
+		JobHandle counter = std::make_shared<JobCounter>();
+		counter->remaining = 1;
+		m_numPending++;
+		submit({ std::move(job), counter }, dependency);
+		return counter;
+	}
+
+	JobHandle JobSystem::parallelFor(int count, int batchSize, std::function<void(int, int)> job, const JobHandle& dependency)
+	{
+		JobHandle counter = std::make_shared<JobCounter>();
+		if (count <= 0) {
+			return counter;
+		}
+		if (batchSize <= 0) {
+			batchSize = std::max(1, count / (getNumThreads() * 4));
+		}
+		int numBatches = (count + batchSize - 1) / batchSize;
+		counter->remaining = numBatches;
+		m_numPending += numBatches;
+
+		//Batches share one copy of the job
+		auto shared = std::make_shared<std::function<void(int, int)>>(std::move(job));
+		for (int begin = 0; begin < count; begin += batchSize)
+		{
+			int end = std::min(begin + batchSize, count);
+			submit({ [shared, begin, end]() { (*shared)(begin, end); }, counter }, dependency);
+		}
+		return counter;
+	}
+
+	void JobSystem::wait(const JobHandle& handle)
+	{
+		int queueIndex = currentQueueIndex();
+		while (!isDone(handle))
+		{
+			if (!tryRunJob(queueIndex)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::waitAll()
+	{
+		//The calling job is pending until it returns, so it would wait for itself forever
+		assert(t_runningJobOf != this && "JobSystem::waitAll called from inside a job, use wait() on a handle");
+		int queueIndex = currentQueueIndex();
+		while (m_numPending > 0)
+		{
+			if (!tryRunJob(queueIndex)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	bool JobSystem::isDone(const JobHandle& handle) const
+	{
+		return handle == nullptr || handle->remaining.load() <= 0;
+	}
+
+	void JobSystem::workerLoop(int queueIndex)
+	{
+		t_jobSystem = this;
+		t_queueIndex = queueIndex;
+		while (true)
+		{
+			if (tryRunJob(queueIndex)) {
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_wake.wait(lock, [this]() { return m_quit || m_numQueued > 0; });
+			if (m_quit) {
+				return;
+			}
+		}
+	}
+
+	int JobSystem::currentQueueIndex() const
+	{
+		if (t_jobSystem == this) {
+			return t_queueIndex;
+		}
+		return (int)m_queues.size() - 1;
+	}
+
+	bool JobSystem::tryRunJob(int queueIndex)
+	{
+		Job job;
+		bool found = false;
+
+		//Own queue first, newest job is the one most likely to be in cache
+		{
+			WorkQueue& queue = *m_queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty()) {
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+				found = true;
+			}
+		}
+		//Steal the oldest job from another queue
+		for (size_t i = 1; !found && i < m_queues.size(); i++)
+		{
+			WorkQueue& queue = *m_queues[(queueIndex + i) % m_queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty()) {
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+				found = true;
+			}
+		}
+		if (!found) {
+			return false;
+		}
+
+		m_numQueued--;
+		const JobSystem* outer = t_runningJobOf;
+		t_runningJobOf = this;
+		job.function();
+		t_runningJobOf = outer;
+		finish(job);
+		return true;
+	}
+
+	void JobSystem::submit(Job job, const JobHandle& dependency)
+	{
+		if (dependency != nullptr) {
+			std::lock_guard<std::mutex> lock(dependency->mutex);
+			if (dependency->remaining > 0) {
+				dependency->continuations.push_back(std::move(job));
+				return;
+			}
+		}
+		enqueue(std::move(job));
+	}
+
+	void JobSystem::enqueue(Job job)
+	{
+		{
+			WorkQueue& queue = *m_queues[currentQueueIndex()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(std::move(job));
+		}
+		m_numQueued++;
+		//Taking the lock orders this with a worker checking m_numQueued before it sleeps
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_wake.notify_one();
+	}
+
+	void JobSystem::finish(Job& job)
+	{
+		JobCounter& counter = *job.counter;
+		if (--counter.remaining == 0) {
+			std::vector<Job> continuations;
+			{
+				std::lock_guard<std::mutex> lock(counter.mutex);
+				continuations.swap(counter.continuations);
+			}
+			for (size_t i = 0; i < continuations.size(); i++)
+			{
+				enqueue(std::move(continuations[i]));
+			}
+		}
+		m_numPending--;
+	}
+}
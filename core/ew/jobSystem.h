@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ew {
+	struct JobCounter;
+	//Tracks completion of a scheduled job (or every batch of a parallelFor)
+	typedef std::shared_ptr<JobCounter> JobHandle;
+
+	struct Job {
+		std::function<void()> function;
+		JobHandle counter;
+	};
+
+	struct JobCounter {
+		std::atomic<int> remaining{ 0 };
+		std::mutex mutex;
+		std::vector<Job> continuations; //Jobs waiting for this counter to reach 0
+	};
+
+	//Work-stealing task scheduler.
+	//Every worker owns a queue, runs its newest job first and steals the oldest
+	//jobs from other queues when it runs dry. Threads that wait on a handle run
+	//jobs too, so wait() from inside a job cannot deadlock.
+	class JobSystem {
+	public:
+		//0 workers = one per hardware thread, minus the calling thread
+		JobSystem(unsigned int numWorkers = 0);
+		~JobSystem();
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		//Runs job once dependency (if any) has completed
+		JobHandle schedule(std::function<void()> job, const JobHandle& dependency = nullptr);
+		//Splits [0, count) into batches of batchSize and runs job(begin, end) on each.
+		//batchSize 0 picks a size that gives every thread a few batches.
+		JobHandle parallelFor(int count, int batchSize, std::function<void(int, int)> job, const JobHandle& dependency = nullptr);
+		//Runs queued jobs on the calling thread until handle has completed
+		void wait(const JobHandle& handle);
+		//Waits for everything scheduled so far, including pending continuations.
+		//Only call it from outside this system's jobs: a calling job counts as pending, so it would never return.
+		//Asserts in debug builds. Inside a job, wait() on the handles it needs instead.
+		void waitAll();
+		bool isDone(const JobHandle& handle) const;
+		inline int getNumWorkers()const { return (int)m_workers.size(); }
+		//Workers plus the calling thread
+		inline int getNumThreads()const { return (int)m_workers.size() + 1; }
+	private:
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+		void workerLoop(int queueIndex);
+		int currentQueueIndex()const;
+		bool tryRunJob(int queueIndex);
+		void submit(Job job, const JobHandle& dependency);
+		void enqueue(Job job);
+		void finish(Job& job);
+
+		std::vector<std::thread> m_workers;
+		//One queue per worker, the last one is shared by every other thread
+		std::vector<std::unique_ptr<WorkQueue>> m_queues;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		std::atomic<int> m_numQueued{ 0 }; //Jobs sitting in queues
+		std::atomic<int> m_numPending{ 0 }; //Jobs scheduled but not finished
+		std::atomic<bool> m_quit{ false };
+	};
+}
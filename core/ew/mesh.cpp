@@ -7,35 +7,73 @@
 
 #include "mesh.h"
 #include "external/glad.h"
+#include <glm/gtc/packing.hpp>
+#include <cstring>
 
 namespace ew {
-	Mesh::Mesh(const MeshData& meshData)
+	const int INSTANCE_MODEL_ATTRIBUTE = 5; //Locations 5-8, one per column
+	const int INSTANCE_NORMAL_ATTRIBUTE = 9; //Locations 9-12
+
+	//Points four consecutive attributes at the columns of per-instance mat4s in buffer
+	static void setInstanceMatrixAttribute(int location, unsigned int buffer)
 	{
-		load(meshData);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		for (int column = 0; column < 4; column++)
+		{
+			glVertexAttribPointer(location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (const void*)(sizeof(glm::vec4) * column));
+			glEnableVertexAttribArray(location + column);
+			glVertexAttribDivisor(location + column, 1);
+		}
 	}
-	void Mesh::load(const MeshData& meshData)
+
+	//Vertex layouts of the packed formats
+	struct PackedVertex {
+		glm::vec3 pos;
+		unsigned short normal[2]; //Octahedral, snorm
+		unsigned short uv[2]; //Half float
+	};
+	struct QuantizedVertex {
+		unsigned short pos[4]; //unorm inside the mesh's bounds, the 4th keeps the rest 4 byte aligned
+		unsigned short normal[2];
+		unsigned short uv[2];
+	};
+
+	static int vertexSize(VertexFormat format)
+	{
+		switch (format) {
+		case VertexFormat::PACKED:
+			return sizeof(PackedVertex);
+		case VertexFormat::QUANTIZED:
+			return sizeof(QuantizedVertex);
+		default:
+			return sizeof(Vertex);
+		}
+	}
+
+	//Folds the unit sphere onto the [-1, 1] square (Cigolle et al. 2014), the shader unfolds it
+	static void packOctahedral(const glm::vec3& normal, unsigned short* packed)
+	{
+		float sum = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+		glm::vec2 p = (sum > 0) ? glm::vec2(normal.x, normal.y) / sum : glm::vec2(0.0f);
+		if (normal.z < 0) {
+			glm::vec2 folded = glm::vec2(1.0f - glm::abs(p.y), 1.0f - glm::abs(p.x));
+			p.x = (p.x >= 0) ? folded.x : -folded.x;
+			p.y = (p.y >= 0) ? folded.y : -folded.y;
+		}
+		packed[0] = glm::packSnorm1x16(p.x);
+		packed[1] = glm::packSnorm1x16(p.y);
+	}
+
+	Mesh::Mesh(const MeshData& meshData, VertexFormat format)
+	{
+		load(meshData, format);
+	}
+	void Mesh::load(const MeshData& meshData, VertexFormat format)
 	{
 		if (!m_initialized) {
 			glGenVertexArrays(1, &m_vao);
-			glBindVertexArray(m_vao);
-
 			glGenBuffers(1, &m_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-
 			glGenBuffers(1, &m_ebo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-			//Position attribute
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
-			glEnableVertexAttribArray(0);
-
-			//Normal attribute
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
-			glEnableVertexAttribArray(1);
-
-			//UV attribute
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
-			glEnableVertexAttribArray(2);
-
 			m_initialized = true;
 		}
 
@@ -43,11 +81,52 @@ namespace ew {
 		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
 
+		//Skinned meshes stay FLOAT: skinned.vert reads a vec3 normal, and quantizing would clamp
+		//deformed vertices to the bind pose bounds
+		if (!meshData.skinWeights.empty()) {
+			format = VertexFormat::FLOAT;
+		}
+		m_format = format;
+		setVertexAttributes();
+
 		if (meshData.vertices.size() > 0) {
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
+			//Quantized positions cover the mesh's bounds
+			m_positionOffset = glm::vec3(0.0f);
+			m_positionScale = glm::vec3(1.0f);
+			if (format == VertexFormat::QUANTIZED) {
+				glm::vec3 min = meshData.vertices[0].pos;
+				glm::vec3 max = min;
+				for (const Vertex& vertex : meshData.vertices) {
+					min = glm::min(min, vertex.pos);
+					max = glm::max(max, vertex.pos);
+				}
+				m_positionOffset = min;
+				m_positionScale = max - min;
+			}
+			//Skinned vertices are rewritten every frame
+			GLenum usage = meshData.skinWeights.empty() ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
+			if (format == VertexFormat::FLOAT) {
+				glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), usage);
+			}
+			else {
+				std::vector<unsigned char> packed;
+				packVertices(meshData.vertices.data(), (int)meshData.vertices.size(), packed);
+				glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), usage);
+			}
+		}
+		if (meshData.skinWeights.size() > 0) {
+			loadSkinWeights(meshData.skinWeights);
 		}
+		//Every index of a mesh under 65536 vertices fits in 16 bits
+		m_indexType = (meshData.vertices.size() < 65536) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 		if (meshData.indices.size() > 0) {
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+			if (m_indexType == GL_UNSIGNED_SHORT) {
+				std::vector<unsigned short> indices(meshData.indices.begin(), meshData.indices.end());
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * indices.size(), indices.data(), GL_STATIC_DRAW);
+			}
+			else {
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+			}
 		}
 		m_numVertices = meshData.vertices.size();
 		m_numIndices = meshData.indices.size();
@@ -56,15 +135,141 @@ namespace ew {
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
+	void Mesh::setVertexAttributes() const
+	{
+		//Expects m_vbo to be bound
+		int stride = vertexSize(m_format);
+		if (m_format == VertexFormat::FLOAT) {
+			//Position attribute
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(Vertex, pos));
+			//Normal attribute
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(Vertex, normal));
+			//UV attribute
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(Vertex, uv));
+		}
+		else if (m_format == VertexFormat::PACKED) {
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(PackedVertex, pos));
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (const void*)offsetof(PackedVertex, normal));
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (const void*)offsetof(PackedVertex, uv));
+		}
+		else {
+			//0 to 1 across the bounds
+			glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void*)offsetof(QuantizedVertex, pos));
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (const void*)offsetof(QuantizedVertex, normal));
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (const void*)offsetof(QuantizedVertex, uv));
+		}
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+	}
+	void Mesh::packVertices(const Vertex* vertices, int count, std::vector<unsigned char>& packed) const
+	{
+		packed.resize((size_t)vertexSize(m_format) * count);
+		if (m_format == VertexFormat::PACKED) {
+			PackedVertex* out = (PackedVertex*)packed.data();
+			for (int i = 0; i < count; i++) {
+				out[i].pos = vertices[i].pos;
+				packOctahedral(vertices[i].normal, out[i].normal);
+				out[i].uv[0] = glm::packHalf1x16(vertices[i].uv.x);
+				out[i].uv[1] = glm::packHalf1x16(vertices[i].uv.y);
+			}
+		}
+		else if (m_format == VertexFormat::QUANTIZED) {
+			QuantizedVertex* out = (QuantizedVertex*)packed.data();
+			//Flat bounds quantize to 0 on that axis
+			glm::vec3 invScale;
+			for (int axis = 0; axis < 3; axis++) {
+				invScale[axis] = (m_positionScale[axis] > 0) ? 1.0f / m_positionScale[axis] : 0.0f;
+			}
+			for (int i = 0; i < count; i++) {
+				glm::vec3 unit = (vertices[i].pos - m_positionOffset) * invScale;
+				for (int axis = 0; axis < 3; axis++) {
+					out[i].pos[axis] = glm::packUnorm1x16(unit[axis]);
+				}
+				out[i].pos[3] = 0;
+				packOctahedral(vertices[i].normal, out[i].normal);
+				out[i].uv[0] = glm::packHalf1x16(vertices[i].uv.x);
+				out[i].uv[1] = glm::packHalf1x16(vertices[i].uv.y);
+			}
+		}
+		else {
+			memcpy(packed.data(), vertices, sizeof(Vertex) * count);
+		}
+	}
+	void Mesh::setPositionUniforms(const Shader& shader) const
+	{
+		shader.setVec3("_PositionOffset", m_positionOffset);
+		shader.setVec3("_PositionScale", m_positionScale);
+	}
+	void Mesh::loadSkinWeights(const std::vector<SkinWeights>& skinWeights)
+	{
+		//Weights live in their own buffer so CPU skinning can rewrite vertices without touching them
+		if (m_skinVbo == 0) {
+			glGenBuffers(1, &m_skinVbo);
+			glBindBuffer(GL_ARRAY_BUFFER, m_skinVbo);
+
+			//Bone index attribute
+			glVertexAttribIPointer(3, 4, GL_INT, sizeof(SkinWeights), (const void*)offsetof(SkinWeights, bones));
+			glEnableVertexAttribArray(3);
+
+			//Bone weight attribute
+			glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(SkinWeights), (const void*)offsetof(SkinWeights, weights));
+			glEnableVertexAttribArray(4);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_skinVbo);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(SkinWeights) * skinWeights.size(), skinWeights.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	}
+	void Mesh::updateVertices(const Vertex* vertices, int count)
+	{
+		if (!m_initialized || count <= 0) {
+			return;
+		}
+		if (count > (int)m_numVertices) {
+			count = m_numVertices;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		if (m_format == VertexFormat::FLOAT) {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * count, vertices);
+		}
+		else {
+			std::vector<unsigned char> packed;
+			packVertices(vertices, count, packed);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, packed.size(), packed.data());
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
 	void Mesh::draw(ew::DrawMode drawMode) const
 	{
 		glBindVertexArray(m_vao);
 		if (drawMode == DrawMode::TRIANGLES) {
-			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
+			glDrawElements(GL_TRIANGLES, m_numIndices, m_indexType, NULL);
 		}
 		else {
 			glDrawArrays(GL_POINTS, 0, m_numVertices);
 		}
 		
 	}
-}
\ No newline at end of file
+	void Mesh::drawInstanced(const InstanceBuffer& models, const InstanceBuffer& normals, int count, ew::DrawMode drawMode) const
+	{
+		if (count <= 0) {
+			return;
+		}
+		glBindVertexArray(m_vao);
+		//Attribute pointers are part of the VAO, only respecify them when the buffers change.
+		//Compared by generation, a new buffer can get the name of one that was deleted.
+		if (m_instanceModels != models.getGeneration() || m_instanceNormals != normals.getGeneration()) {
+			setInstanceMatrixAttribute(INSTANCE_MODEL_ATTRIBUTE, models.getBuffer());
+			setInstanceMatrixAttribute(INSTANCE_NORMAL_ATTRIBUTE, normals.getBuffer());
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			m_instanceModels = models.getGeneration();
+			m_instanceNormals = normals.getGeneration();
+		}
+		if (drawMode == DrawMode::TRIANGLES) {
+			glDrawElementsInstanced(GL_TRIANGLES, m_numIndices, m_indexType, NULL, count);
+		}
+		else {
+			glDrawArraysInstanced(GL_POINTS, 0, m_numVertices, count);
+		}
+	}
+}
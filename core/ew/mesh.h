@@ -5,6 +5,8 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <vector>
+#include "instanceBuffer.h"
+#include "shader.h"
 
 namespace ew {
 	struct Vertex {
@@ -13,9 +15,18 @@ namespace ew {
 		glm::vec2 uv;
 	};
 
+	const int MAX_BONE_INFLUENCES = 4;
+
+	//Bones affecting one vertex, indices into the model's bone list
+	struct SkinWeights {
+		glm::ivec4 bones = glm::ivec4(0);
+		glm::vec4 weights = glm::vec4(0.0f); //Sum to 1, all 0 for vertices no bone affects
+	};
+
 	struct MeshData {
 		std::vector<Vertex> vertices;
 		std::vector<unsigned int> indices;
+		std::vector<SkinWeights> skinWeights; //One per vertex for skinned meshes, otherwise empty
 	};
 
 	enum class DrawMode {
@@ -23,20 +34,55 @@ namespace ew {
 		POINTS = 1
 	};
 
+	//How a mesh stores its vertices on the GPU. Packed formats need a vertex shader that decodes
+	//the octahedral normal in attribute 1 (a vec2), QUANTIZED also _PositionOffset + vPos * _PositionScale.
+	//FLOAT goes with lit.vert, litInstanced.vert and skinned.vert, PACKED and QUANTIZED with litInstancedPacked.vert.
+	enum class VertexFormat {
+		FLOAT = 0, //ew::Vertex as is, 32 bytes. Meshes with skin weights always get FLOAT.
+		PACKED = 1, //Float position, octahedral normal, half float UV, 20 bytes
+		QUANTIZED = 2 //PACKED with 16 bit positions inside the mesh's bounds, 16 bytes
+	};
+
 	class Mesh {
 	public:
 		Mesh() {};
-		Mesh(const MeshData& meshData);
-		void load(const MeshData& meshData);
+		Mesh(const MeshData& meshData, VertexFormat format = VertexFormat::FLOAT);
+		//Meshes under 65536 vertices get 16 bit indices
+		void load(const MeshData& meshData, VertexFormat format = VertexFormat::FLOAT);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//One draw call for count instances. Attributes 5-8 read each instance's model matrix
+		//from models, 9-12 its normal matrix from normals.
+		void drawInstanced(const InstanceBuffer& models, const InstanceBuffer& normals, int count, DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Overwrites the first count vertices, for meshes deformed on the CPU every frame
+		//Positions of QUANTIZED meshes are clamped to the bounds the mesh was loaded with
+		void updateVertices(const Vertex* vertices, int count);
+		//Sets _PositionOffset and _PositionScale, which turn a QUANTIZED mesh's positions back into model space
+		void setPositionUniforms(const Shader& shader)const;
+		inline VertexFormat getVertexFormat()const { return m_format; }
+		inline glm::vec3 getPositionOffset()const { return m_positionOffset; }
+		inline glm::vec3 getPositionScale()const { return m_positionScale; }
+		//Skinned meshes have bone indices at attribute 3 and weights at attribute 4
+		inline bool isSkinned()const { return m_skinVbo != 0; }
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
 	private:
+		void loadSkinWeights(const std::vector<SkinWeights>& skinWeights);
+		void setVertexAttributes()const;
+		//Converts count vertices to m_format
+		void packVertices(const Vertex* vertices, int count, std::vector<unsigned char>& packed)const;
 		bool m_initialized = false;
 		unsigned int m_vao = 0;
 		unsigned int m_vbo = 0;
 		unsigned int m_ebo = 0;
+		unsigned int m_skinVbo = 0; //Bone indices and weights, 0 if the mesh is not skinned
+		//Generations of the instance buffers the VAO's instance attributes currently point at
+		mutable unsigned int m_instanceModels = 0;
+		mutable unsigned int m_instanceNormals = 0;
 		unsigned int m_numVertices = 0;
 		unsigned int m_numIndices = 0;
+		unsigned int m_indexType = 0; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		VertexFormat m_format = VertexFormat::FLOAT;
+		glm::vec3 m_positionOffset = glm::vec3(0.0f); //Minimum corner of the bounds for QUANTIZED
+		glm::vec3 m_positionScale = glm::vec3(1.0f); //Size of the bounds for QUANTIZED
 	};
 }
\ No newline at end of file
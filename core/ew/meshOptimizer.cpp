@@ -0,0 +1,279 @@
+#include "meshOptimizer.h"
+#include <algorithm>
+
+namespace ew {
+	//FIFO cache simulated with timestamps: a vertex is cached if it was added less than cacheSize misses ago
+	struct VertexCache {
+		std::vector<unsigned int> addedAt;
+		unsigned int time;
+		unsigned int size;
+
+		VertexCache(int vertexCount, int cacheSize) : addedAt(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+		bool contains(unsigned int vertex)const {
+			return time - addedAt[vertex] <= size;
+		}
+
+		//Empties the cache without touching every vertex
+		void flush() {
+			time += size + 1;
+		}
+
+		//Returns 1 on a miss
+		int use(unsigned int vertex) {
+			if (contains(vertex)) {
+				return 0;
+			}
+			addedAt[vertex] = time++;
+			return 1;
+		}
+
+		int useTriangle(const unsigned int* triangle) {
+			return use(triangle[0]) + use(triangle[1]) + use(triangle[2]);
+		}
+	};
+
+	float computeACMR(const std::vector<unsigned int>& indices, int vertexCount, int cacheSize)
+	{
+		int numTriangles = (int)indices.size() / 3;
+		if (numTriangles == 0) {
+			return 0;
+		}
+		VertexCache cache(vertexCount, cacheSize);
+		int misses = 0;
+		for (int t = 0; t < numTriangles; t++) {
+			misses += cache.useTriangle(&indices[t * 3]);
+		}
+		return (float)misses / numTriangles;
+	}
+
+	void optimizeVertexCache(std::vector<unsigned int>& indices, int vertexCount, int cacheSize)
+	{
+		int numTriangles = (int)indices.size() / 3;
+		if (numTriangles == 0) {
+			return;
+		}
+		//Triangles using each vertex, vertex v's are adjacency[offsets[v]..offsets[v + 1])
+		std::vector<int> offsets(vertexCount + 1, 0);
+		for (int i = 0; i < numTriangles * 3; i++) {
+			offsets[indices[i] + 1]++;
+		}
+		for (int v = 0; v < vertexCount; v++) {
+			offsets[v + 1] += offsets[v];
+		}
+		std::vector<int> adjacency(numTriangles * 3);
+		std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+		for (int i = 0; i < numTriangles * 3; i++) {
+			adjacency[fill[indices[i]]++] = i / 3;
+		}
+		//Triangles not emitted yet per vertex
+		std::vector<int> live(vertexCount);
+		for (int v = 0; v < vertexCount; v++) {
+			live[v] = offsets[v + 1] - offsets[v];
+		}
+
+		std::vector<unsigned int> result;
+		result.reserve(numTriangles * 3);
+		std::vector<bool> emitted(numTriangles, false);
+		VertexCache cache(vertexCount, cacheSize);
+		std::vector<unsigned int> deadEnd; //Recently used vertices, to continue from when fanning gets stuck
+		std::vector<unsigned int> candidates;
+		int nextInput = 1; //Next vertex to try in input order once the dead-end stack is empty
+		int fan = 0;
+		while (fan >= 0) {
+			//Emit every remaining triangle around the fanning vertex
+			candidates.clear();
+			for (int a = offsets[fan]; a < offsets[fan + 1]; a++) {
+				int t = adjacency[a];
+				if (emitted[t]) {
+					continue;
+				}
+				emitted[t] = true;
+				for (int k = 0; k < 3; k++) {
+					unsigned int v = indices[t * 3 + k];
+					result.push_back(v);
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					live[v]--;
+					cache.use(v);
+				}
+			}
+			//Next fanning vertex: the oldest candidate that will still be cached after its fan is emitted
+			fan = -1;
+			int bestPriority = -1;
+			for (unsigned int v : candidates) {
+				if (live[v] == 0) {
+					continue;
+				}
+				int priority = 0;
+				int age = (int)(cache.time - cache.addedAt[v]);
+				if (age + 2 * live[v] <= cacheSize) {
+					priority = age;
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					fan = (int)v;
+				}
+			}
+			//Dead end, back up to a recently used vertex or move on in input order
+			while (fan < 0 && !deadEnd.empty()) {
+				unsigned int v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0) {
+					fan = (int)v;
+				}
+			}
+			while (fan < 0 && nextInput < vertexCount) {
+				if (live[nextInput] > 0) {
+					fan = nextInput;
+				}
+				nextInput++;
+			}
+		}
+		//Anything past the last whole triangle is kept as is
+		result.insert(result.end(), indices.begin() + numTriangles * 3, indices.end());
+		indices.swap(result);
+	}
+
+	void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, int cacheSize, float threshold)
+	{
+		int numTriangles = (int)indices.size() / 3;
+		if (numTriangles == 0) {
+			return;
+		}
+		VertexCache cache((int)vertices.size(), cacheSize);
+
+		//Hard boundaries where a triangle misses on all three vertices, usually a new patch of the mesh
+		std::vector<int> hard;
+		for (int t = 0; t < numTriangles; t++) {
+			if (cache.useTriangle(&indices[t * 3]) == 3 || t == 0) {
+				hard.push_back(t);
+			}
+		}
+		hard.push_back(numTriangles);
+
+		//Split further wherever the running ACMR since the last split gets within threshold of the patch's ACMR
+		std::vector<int> clusters;
+		for (size_t h = 0; h + 1 < hard.size(); h++) {
+			int begin = hard[h];
+			int end = hard[h + 1];
+			cache.flush();
+			int patchMisses = 0;
+			for (int t = begin; t < end; t++) {
+				patchMisses += cache.useTriangle(&indices[t * 3]);
+			}
+			float patchThreshold = threshold * patchMisses / (end - begin);
+
+			clusters.push_back(begin);
+			cache.flush();
+			int misses = 0;
+			int count = 0;
+			for (int t = begin; t < end; t++) {
+				misses += cache.useTriangle(&indices[t * 3]);
+				count++;
+				if ((float)misses / count <= patchThreshold && t + 1 < end) {
+					clusters.push_back(t + 1);
+					cache.flush();
+					misses = 0;
+					count = 0;
+				}
+			}
+			//The tail never reached the target, merge it into the cluster before it
+			if (count > 0 && clusters.back() != begin) {
+				clusters.pop_back();
+			}
+		}
+		clusters.push_back(numTriangles);
+		int numClusters = (int)clusters.size() - 1;
+
+		//Area weighted centroid and normal of the mesh and each cluster
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0;
+		std::vector<glm::vec3> centroids(numClusters, glm::vec3(0.0f));
+		std::vector<glm::vec3> normals(numClusters, glm::vec3(0.0f));
+		for (int c = 0; c < numClusters; c++) {
+			float area = 0;
+			for (int t = clusters[c]; t < clusters[c + 1]; t++) {
+				const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+				const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+				const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0); //Length is twice the area
+				float triangleArea = glm::length(normal);
+				centroids[c] += (p0 + p1 + p2) * (triangleArea / 3.0f);
+				normals[c] += normal;
+				area += triangleArea;
+			}
+			meshCentroid += centroids[c];
+			meshArea += area;
+			centroids[c] = (area > 0) ? centroids[c] / area : glm::vec3(0.0f);
+		}
+		if (meshArea > 0) {
+			meshCentroid /= meshArea;
+		}
+
+		//Clusters facing away from the middle of the mesh are likely to occlude the rest, draw them first
+		std::vector<float> sortKeys(numClusters);
+		for (int c = 0; c < numClusters; c++) {
+			float length = glm::length(normals[c]);
+			sortKeys[c] = (length > 0) ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : 0.0f;
+		}
+		std::vector<int> order(numClusters);
+		for (int c = 0; c < numClusters; c++) {
+			order[c] = c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&sortKeys](int a, int b) {
+			return sortKeys[a] > sortKeys[b];
+		});
+
+		std::vector<unsigned int> result;
+		result.reserve(indices.size());
+		for (int c : order) {
+			result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+		}
+		result.insert(result.end(), indices.begin() + numTriangles * 3, indices.end());
+		indices.swap(result);
+	}
+
+	void optimizeVertexFetch(MeshData& meshData)
+	{
+		const unsigned int UNUSED = 0xFFFFFFFF;
+		std::vector<unsigned int> remap(meshData.vertices.size(), UNUSED);
+		unsigned int numUsed = 0;
+		for (unsigned int& index : meshData.indices) {
+			if (remap[index] == UNUSED) {
+				remap[index] = numUsed++;
+			}
+			index = remap[index];
+		}
+
+		std::vector<Vertex> vertices(numUsed);
+		for (size_t v = 0; v < remap.size(); v++) {
+			if (remap[v] != UNUSED) {
+				vertices[remap[v]] = meshData.vertices[v];
+			}
+		}
+		meshData.vertices.swap(vertices);
+
+		if (!meshData.skinWeights.empty()) {
+			std::vector<SkinWeights> skinWeights(numUsed);
+			for (size_t v = 0; v < remap.size(); v++) {
+				if (remap[v] != UNUSED) {
+					skinWeights[remap[v]] = meshData.skinWeights[v];
+				}
+			}
+			meshData.skinWeights.swap(skinWeights);
+		}
+	}
+
+	MeshOptimizeReport optimizeMesh(MeshData& meshData, int cacheSize)
+	{
+		MeshOptimizeReport report;
+		int vertexCount = (int)meshData.vertices.size();
+		report.acmrBefore = computeACMR(meshData.indices, vertexCount, cacheSize);
+		optimizeVertexCache(meshData.indices, vertexCount, cacheSize);
+		optimizeOverdraw(meshData.indices, meshData.vertices, cacheSize);
+		optimizeVertexFetch(meshData);
+		report.acmrAfter = computeACMR(meshData.indices, (int)meshData.vertices.size(), cacheSize);
+		return report;
+	}
+}
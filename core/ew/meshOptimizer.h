@@ -0,0 +1,32 @@
+#pragma once
+#include "mesh.h"
+#include <vector>
+
+namespace ew {
+	//Post-transform vertex cache size the optimizer and ACMR assume. Smaller than most
+	//hardware caches, so orders tuned for it still do well on larger ones.
+	const int VERTEX_CACHE_SIZE = 16;
+	//How much worse than Tipsify's ACMR optimizeOverdraw may make each cluster
+	const float OVERDRAW_THRESHOLD = 1.05f;
+
+	//Average cache miss ratio (vertex shader invocations per triangle) of indices on a FIFO cache.
+	//3 is the worst case, about 0.5 is the best a regular grid can get.
+	float computeACMR(const std::vector<unsigned int>& indices, int vertexCount, int cacheSize = VERTEX_CACHE_SIZE);
+
+	//Reorders triangles for the vertex cache (Tipsify, Sander et al. 2007)
+	void optimizeVertexCache(std::vector<unsigned int>& indices, int vertexCount, int cacheSize = VERTEX_CACHE_SIZE);
+	//Reorders clusters of a cache-optimized triangle order so outward-facing clusters come first,
+	//giving up at most threshold times the cluster's ACMR
+	void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, int cacheSize = VERTEX_CACHE_SIZE, float threshold = OVERDRAW_THRESHOLD);
+	//Renumbers vertices in the order triangles first use them and drops unused ones.
+	//Skin weights, if any, are reordered with the vertices.
+	void optimizeVertexFetch(MeshData& meshData);
+
+	struct MeshOptimizeReport {
+		float acmrBefore = 0;
+		float acmrAfter = 0;
+	};
+
+	//All three passes in order. Deterministic, the same input always gives the same output.
+	MeshOptimizeReport optimizeMesh(MeshData& meshData, int cacheSize = VERTEX_CACHE_SIZE);
+}
@@ -10,33 +10,78 @@
 #include <glm/glm.hpp>
 
 namespace ew {
-	ew::Mesh processAiMesh(aiMesh* aiMesh);
+	ew::MeshData processAiMesh(aiMesh* aiMesh, std::vector<Bone>& bones);
 
-	Model::Model(const std::string& filePath)
+	Model::Model(const std::string& filePath, bool optimize, VertexFormat format)
 	{
 		Assimp::Importer importer;
 		const aiScene* aiScene = importer.ReadFile(filePath, aiProcess_Triangulate);
 		for (size_t i = 0; i < aiScene->mNumMeshes; i++)
 		{
 			aiMesh* aiMesh = aiScene->mMeshes[i];
-			m_meshes.push_back(processAiMesh(aiMesh));
+			ew::MeshData meshData = processAiMesh(aiMesh, m_bones);
+			m_optimizeReports.push_back(optimize ? optimizeMesh(meshData) : MeshOptimizeReport());
+			m_meshes.push_back(ew::Mesh(meshData, format));
+			//Skinning needs the bind pose every frame, static meshes don't
+			if (meshData.skinWeights.empty()) {
+				meshData = ew::MeshData();
+			}
+			m_meshData.push_back(std::move(meshData));
 		}
 	}
 
-	void Model::draw()
+	void Model::draw(const Shader* shader)
 	{
 		for (size_t i = 0; i < m_meshes.size(); i++)
 		{
+			if (shader != nullptr) {
+				m_meshes[i].setPositionUniforms(*shader);
+			}
 			m_meshes[i].draw();
 		}
 	}
 
+	void Model::drawInstanced(const InstanceBuffer& models, const InstanceBuffer& normals, int count, const Shader* shader)
+	{
+		for (size_t i = 0; i < m_meshes.size(); i++)
+		{
+			if (shader != nullptr) {
+				m_meshes[i].setPositionUniforms(*shader);
+			}
+			m_meshes[i].drawInstanced(models, normals, count);
+		}
+	}
+
 	glm::vec3 convertAIVec3(const aiVector3D& v) {
 		return glm::vec3(v.x, v.y, v.z);
 	}
 
+	glm::mat4 convertAIMat4(const aiMatrix4x4& m) {
+		//aiMatrix4x4 is row major
+		return glm::mat4(
+			m.a1, m.b1, m.c1, m.d1,
+			m.a2, m.b2, m.c2, m.d2,
+			m.a3, m.b3, m.c3, m.d3,
+			m.a4, m.b4, m.c4, m.d4
+		);
+	}
+
+	//Index of the bone with aiBone's name and offset, added if the model does not have it yet.
+	//Meshes bound at different poses have different offsets for the same node, so the name alone
+	//would skin every mesh but the first with the wrong inverse bind matrix.
+	int findBone(std::vector<Bone>& bones, const aiBone* aiBone) {
+		glm::mat4 offset = convertAIMat4(aiBone->mOffsetMatrix);
+		for (size_t i = 0; i < bones.size(); i++) {
+			if (bones[i].name == aiBone->mName.C_Str() && bones[i].offset == offset) {
+				return (int)i;
+			}
+		}
+		bones.push_back({ aiBone->mName.C_Str(), offset });
+		return (int)bones.size() - 1;
+	}
+
 	//Utility functions local to this file
-	ew::Mesh processAiMesh(aiMesh* aiMesh) {
+	ew::MeshData processAiMesh(aiMesh* aiMesh, std::vector<Bone>& bones) {
 		ew::MeshData meshData;
 		for (size_t i = 0; i < aiMesh->mNumVertices; i++)
 		{
@@ -58,7 +103,37 @@ namespace ew {
 				meshData.indices.push_back(aiMesh->mFaces[i].mIndices[j]);
 			}
 		}
-		return ew::Mesh(meshData);
+		//Keep the strongest MAX_BONE_INFLUENCES bones per vertex
+		if (aiMesh->HasBones()) {
+			meshData.skinWeights.resize(aiMesh->mNumVertices);
+			for (size_t i = 0; i < aiMesh->mNumBones; i++)
+			{
+				const aiBone* aiBone = aiMesh->mBones[i];
+				int bone = findBone(bones, aiBone);
+				for (size_t j = 0; j < aiBone->mNumWeights; j++)
+				{
+					const aiVertexWeight& aiWeight = aiBone->mWeights[j];
+					SkinWeights& skin = meshData.skinWeights[aiWeight.mVertexId];
+					int weakest = 0;
+					for (int k = 1; k < MAX_BONE_INFLUENCES; k++) {
+						if (skin.weights[k] < skin.weights[weakest]) {
+							weakest = k;
+						}
+					}
+					if (aiWeight.mWeight > skin.weights[weakest]) {
+						skin.bones[weakest] = bone;
+						skin.weights[weakest] = aiWeight.mWeight;
+					}
+				}
+			}
+			for (SkinWeights& skin : meshData.skinWeights) {
+				float total = skin.weights.x + skin.weights.y + skin.weights.z + skin.weights.w;
+				if (total > 0) {
+					skin.weights /= total;
+				}
+			}
+		}
+		return meshData;
 	}
 
 }
@@ -4,15 +4,39 @@
 
 #pragma once
 #include "mesh.h"
+#include "meshOptimizer.h"
 #include "shader.h"
 #include <vector>
+#include <string>
 
 namespace ew {
+	struct Bone {
+		std::string name; //Name of the node the bone follows
+		glm::mat4 offset; //Mesh space to bone space in the bind pose (inverse bind matrix)
+	};
+
 	class Model {
 	public:
-		Model(const std::string& filePath);
-		void draw();
+		//optimize reorders each mesh's triangles and vertices for the GPU (see optimizeMesh)
+		Model(const std::string& filePath, bool optimize = true, VertexFormat format = VertexFormat::FLOAT);
+		//shader gets each mesh's position uniforms before it is drawn, required for VertexFormat::QUANTIZED
+		void draw(const Shader* shader = nullptr);
+		//Draws count instances of every mesh, one draw call per mesh
+		void drawInstanced(const InstanceBuffer& models, const InstanceBuffer& normals, int count, const Shader* shader = nullptr);
+		inline int getNumMeshes()const { return (int)m_meshes.size(); }
+		inline ew::Mesh& getMesh(int index) { return m_meshes[index]; }
+		//Bind pose vertices and weights, only kept for skinned meshes
+		inline const ew::MeshData& getMeshData(int index)const { return m_meshData[index]; }
+		inline bool isSkinned(int index)const { return !m_meshData[index].skinWeights.empty(); }
+		//Bones of every mesh, SkinWeights::bones index into this. Meshes share a bone when both the
+		//node and the offset match, a node bound differently in two meshes is two bones.
+		inline const std::vector<Bone>& getBones()const { return m_bones; }
+		//ACMR before and after optimizing, both 0 if the model was loaded without optimizing
+		inline const MeshOptimizeReport& getOptimizeReport(int index)const { return m_optimizeReports[index]; }
 	private:
 		std::vector<ew::Mesh> m_meshes;
+		std::vector<ew::MeshData> m_meshData;
+		std::vector<Bone> m_bones;
+		std::vector<MeshOptimizeReport> m_optimizeReports;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "sceneGraph.h"
+#include <algorithm>
+
+namespace ew {
+	NodeId SceneGraph::create(NodeId parent, const Transform& local)
+	{
+		NodeId node;
+		if (!m_freeIds.empty()) {
+			node = m_freeIds.back();
+			m_freeIds.pop_back();
+		}
+		else {
+			node = (NodeId)m_slotOf.size();
+			m_slotOf.push_back(-1);
+			m_parentOf.push_back(NULL_NODE);
+			m_firstChild.push_back(NULL_NODE);
+			m_lastChild.push_back(NULL_NODE);
+			m_nextSibling.push_back(NULL_NODE);
+		}
+		//Appended unsorted, sort() moves it behind its parent
+		m_slotOf[node] = (int)m_nodeAt.size();
+		m_nodeAt.push_back(node);
+		m_parentSlot.push_back(-1);
+		m_subtreeEnd.push_back((int)m_nodeAt.size());
+		m_local.push_back(local);
+		m_world.push_back(glm::mat4(1.0f));
+		m_dirty.push_back(1);
+		m_firstChild[node] = NULL_NODE;
+		m_lastChild[node] = NULL_NODE;
+		m_nextSibling[node] = NULL_NODE;
+		m_parentOf[node] = NULL_NODE;
+		link(node, parent);
+		m_anyDirty = true;
+		m_needsSort = true;
+		return node;
+	}
+
+	void SceneGraph::destroy(NodeId node)
+	{
+		unlink(node);
+		//Free the whole subtree
+		std::vector<NodeId> stack(1, node);
+		while (!stack.empty()) {
+			NodeId n = stack.back();
+			stack.pop_back();
+			for (NodeId c = m_firstChild[n]; c != NULL_NODE; c = m_nextSibling[c]) {
+				stack.push_back(c);
+			}
+			m_nodeAt[m_slotOf[n]] = NULL_NODE;
+			m_slotOf[n] = -1;
+			m_parentOf[n] = NULL_NODE;
+			m_firstChild[n] = NULL_NODE;
+			m_lastChild[n] = NULL_NODE;
+			m_nextSibling[n] = NULL_NODE;
+			m_freeIds.push_back(n);
+		}
+		m_needsSort = true;
+	}
+
+	bool SceneGraph::setParent(NodeId node, NodeId parent)
+	{
+		for (NodeId p = parent; p != NULL_NODE; p = m_parentOf[p]) {
+			if (p == node) {
+				return false;
+			}
+		}
+		unlink(node);
+		link(node, parent);
+		markDirty(node);
+		m_needsSort = true;
+		return true;
+	}
+
+	void SceneGraph::setLocal(NodeId node, const Transform& local)
+	{
+		m_local[m_slotOf[node]] = local;
+		markDirty(node);
+	}
+
+	Transform& SceneGraph::editLocal(NodeId node)
+	{
+		markDirty(node);
+		return m_local[m_slotOf[node]];
+	}
+
+	void SceneGraph::markDirty(NodeId node)
+	{
+		m_dirty[m_slotOf[node]] = 1;
+		m_anyDirty = true;
+	}
+
+	void SceneGraph::unlink(NodeId node)
+	{
+		NodeId parent = m_parentOf[node];
+		if (parent == NULL_NODE) {
+			return;
+		}
+		NodeId previous = NULL_NODE;
+		for (NodeId c = m_firstChild[parent]; c != node; c = m_nextSibling[c]) {
+			previous = c;
+		}
+		if (previous == NULL_NODE) {
+			m_firstChild[parent] = m_nextSibling[node];
+		}
+		else {
+			m_nextSibling[previous] = m_nextSibling[node];
+		}
+		if (m_lastChild[parent] == node) {
+			m_lastChild[parent] = previous;
+		}
+		m_parentOf[node] = NULL_NODE;
+		m_nextSibling[node] = NULL_NODE;
+	}
+
+	void SceneGraph::link(NodeId node, NodeId parent)
+	{
+		m_parentOf[node] = parent;
+		if (parent == NULL_NODE) {
+			return;
+		}
+		//Children keep their creation order
+		if (m_firstChild[parent] == NULL_NODE) {
+			m_firstChild[parent] = node;
+		}
+		else {
+			m_nextSibling[m_lastChild[parent]] = node;
+		}
+		m_lastChild[parent] = node;
+	}
+
+	void SceneGraph::sort()
+	{
+		std::vector<NodeId> order;
+		order.reserve(m_nodeAt.size());
+		std::vector<NodeId> stack;
+		//Roots in storage order, each followed by its subtree depth first
+		for (NodeId root : m_nodeAt) {
+			if (root == NULL_NODE || m_parentOf[root] != NULL_NODE) {
+				continue;
+			}
+			stack.push_back(root);
+			while (!stack.empty()) {
+				NodeId n = stack.back();
+				stack.pop_back();
+				order.push_back(n);
+				//Pushed in reverse so the first child comes out first
+				size_t first = stack.size();
+				for (NodeId c = m_firstChild[n]; c != NULL_NODE; c = m_nextSibling[c]) {
+					stack.push_back(c);
+				}
+				std::reverse(stack.begin() + first, stack.end());
+			}
+		}
+
+		const int count = (int)order.size();
+		std::vector<Transform> local;
+		std::vector<glm::mat4> world;
+		std::vector<uint8_t> dirty;
+		local.reserve(count);
+		world.reserve(count);
+		dirty.reserve(count);
+		for (int i = 0; i < count; i++) {
+			int oldSlot = m_slotOf[order[i]];
+			local.push_back(m_local[oldSlot]);
+			world.push_back(m_world[oldSlot]);
+			dirty.push_back(m_dirty[oldSlot]);
+		}
+		for (int i = 0; i < count; i++) {
+			m_slotOf[order[i]] = i;
+		}
+		m_parentSlot.resize(count);
+		for (int i = 0; i < count; i++) {
+			NodeId parent = m_parentOf[order[i]];
+			m_parentSlot[i] = (parent == NULL_NODE) ? -1 : m_slotOf[parent];
+		}
+		m_subtreeEnd.assign(count, 0);
+		for (int i = count - 1; i >= 0; i--) {
+			m_subtreeEnd[i] = std::max(m_subtreeEnd[i], i + 1);
+			if (m_parentSlot[i] >= 0) {
+				m_subtreeEnd[m_parentSlot[i]] = std::max(m_subtreeEnd[m_parentSlot[i]], m_subtreeEnd[i]);
+			}
+		}
+		m_nodeAt.swap(order);
+		m_local.swap(local);
+		m_world.swap(world);
+		m_dirty.swap(dirty);
+		m_needsSort = false;
+	}
+
+	void SceneGraph::update()
+	{
+		m_numRecomputed = 0;
+		if (m_needsSort) {
+			sort();
+		}
+		if (!m_anyDirty) {
+			return;
+		}
+		const int count = (int)m_nodeAt.size();
+		int i = 0;
+		while (i < count) {
+			if (!m_dirty[i]) {
+				i++;
+				continue;
+			}
+			//A changed node invalidates its whole subtree
+			const int end = m_subtreeEnd[i];
+			for (; i < end; i++) {
+				const Transform& t = m_local[i];
+				glm::mat4 local = composeTRS(t.position, t.rotation, t.scale);
+				m_world[i] = (m_parentSlot[i] < 0) ? local : m_world[m_parentSlot[i]] * local;
+				m_dirty[i] = 0;
+				m_numRecomputed++;
+			}
+		}
+		m_anyDirty = false;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "transform.h"
+
+namespace ew {
+	typedef int NodeId; //Stable handle, reused after a node is destroyed
+	const NodeId NULL_NODE = -1;
+
+	//Hierarchy of local Transforms with cached world matrices.
+	//Nodes are stored depth first (parent before children, every subtree one contiguous range),
+	//so update() walks the arrays front to back and only recomputes subtrees under changed nodes.
+	//Adding, removing or reparenting nodes re-sorts the storage on the next update().
+	//Local matrices use Transform::rotation, not rotEuler.
+	class SceneGraph {
+	public:
+		NodeId create(NodeId parent = NULL_NODE, const Transform& local = Transform());
+		//Destroys node and all of its descendants
+		void destroy(NodeId node);
+		//Returns false if parent is node itself or one of its descendants
+		bool setParent(NodeId node, NodeId parent);
+		NodeId getParent(NodeId node)const { return m_parentOf[node]; }
+		bool isValid(NodeId node)const { return node >= 0 && node < (int)m_slotOf.size() && m_slotOf[node] >= 0; }
+
+		const Transform& getLocal(NodeId node)const { return m_local[m_slotOf[node]]; }
+		void setLocal(NodeId node, const Transform& local);
+		//Marks node changed and returns its local transform for editing, e.g. with ImGui
+		Transform& editLocal(NodeId node);
+
+		//Sorts if the hierarchy changed, then recomputes the world matrices of changed subtrees
+		void update();
+		//Valid after update()
+		const glm::mat4& getWorldMatrix(NodeId node)const { return m_world[m_slotOf[node]]; }
+
+		//Nodes in storage order, e.g. for uploading every world matrix at once. Valid after update().
+		inline int getNumNodes()const { return (int)m_nodeAt.size(); }
+		inline const glm::mat4* getWorldMatrices()const { return m_world.data(); }
+		inline NodeId getNodeAt(int slot)const { return m_nodeAt[slot]; }
+		inline int getNumRecomputed()const { return m_numRecomputed; } //World matrices rebuilt by the last update()
+	private:
+		void markDirty(NodeId node);
+		void unlink(NodeId node);
+		void link(NodeId node, NodeId parent);
+		void sort();
+
+		//Indexed by NodeId
+		std::vector<int> m_slotOf; //-1 for free ids
+		std::vector<NodeId> m_parentOf;
+		std::vector<NodeId> m_firstChild;
+		std::vector<NodeId> m_lastChild;
+		std::vector<NodeId> m_nextSibling;
+		std::vector<NodeId> m_freeIds;
+
+		//Indexed by storage slot
+		std::vector<NodeId> m_nodeAt; //NULL_NODE for destroyed nodes waiting for sort()
+		std::vector<int> m_parentSlot;
+		std::vector<int> m_subtreeEnd; //One past the last descendant
+		std::vector<Transform> m_local;
+		std::vector<glm::mat4> m_world;
+		std::vector<uint8_t> m_dirty;
+
+		bool m_needsSort = false;
+		bool m_anyDirty = false;
+		int m_numRecomputed = 0;
+	};
+}
@@ -0,0 +1,45 @@
+#include "skinPalette.h"
+#include "external/glad.h"
+
+namespace ew {
+	SkinPalette::SkinPalette(unsigned int binding)
+	{
+		m_binding = binding;
+		glGenBuffers(1, &m_ssbo);
+	}
+	SkinPalette::~SkinPalette()
+	{
+		glDeleteBuffers(1, &m_ssbo);
+	}
+	void SkinPalette::clear()
+	{
+		m_matrices.clear();
+	}
+	int SkinPalette::add(const glm::mat4* matrices, int count)
+	{
+		int offset = (int)m_matrices.size();
+		m_matrices.insert(m_matrices.end(), matrices, matrices + count);
+		return offset;
+	}
+	int SkinPalette::allocate(int count)
+	{
+		int offset = (int)m_matrices.size();
+		m_matrices.resize(m_matrices.size() + count);
+		return offset;
+	}
+	void SkinPalette::upload()
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ssbo);
+		if (m_matrices.size() > m_capacity) {
+			//Grow with some headroom so adding instances doesn't reallocate every frame
+			m_capacity = m_matrices.size() + m_matrices.size() / 2;
+		}
+		//Orphans last frame's storage instead of waiting for draws still reading it
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::mat4) * m_capacity, NULL, GL_DYNAMIC_DRAW);
+		if (m_matrices.size() > 0) {
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(glm::mat4) * m_matrices.size(), m_matrices.data());
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_binding, m_ssbo);
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ew {
+	//Joint matrices of every skinned instance drawn in a frame, in one shader storage buffer.
+	//Each instance appends its palette with add() and draws with the returned offset
+	//as the shader's _PaletteOffset, so all instances share one upload and one binding.
+	class SkinPalette {
+	public:
+		SkinPalette(unsigned int binding = 0);
+		~SkinPalette();
+		SkinPalette(const SkinPalette&) = delete;
+		SkinPalette& operator=(const SkinPalette&) = delete;
+		//Starts a new frame, forgetting every palette added so far
+		void clear();
+		//Appends count matrices, returns the index of the first one
+		int add(const glm::mat4* matrices, int count);
+		//Reserves count matrices to be written through data(), returns the index of the first one
+		int allocate(int count);
+		glm::mat4* data() { return m_matrices.data(); }
+		//Uploads every added matrix and binds the buffer to its binding point
+		void upload();
+		inline int getNumMatrices()const { return (int)m_matrices.size(); }
+	private:
+		unsigned int m_ssbo = 0;
+		unsigned int m_binding = 0;
+		size_t m_capacity = 0; //Matrices the buffer currently has room for
+		std::vector<glm::mat4> m_matrices;
+	};
+}
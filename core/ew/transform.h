@@ -8,6 +8,17 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace ew {
+	//translate * rotate * scale built directly, same result as glm::translate, mat4_cast and glm::scale
+	inline glm::mat4 composeTRS(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+		glm::mat3 r = glm::mat3_cast(rotation);
+		return glm::mat4(
+			glm::vec4(r[0] * scale.x, 0.0f),
+			glm::vec4(r[1] * scale.y, 0.0f),
+			glm::vec4(r[2] * scale.z, 0.0f),
+			glm::vec4(position, 1.0f)
+		);
+	}
+
 	struct Transform {
 		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
 		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f,0.0f);
@@ -15,19 +26,65 @@ namespace ew {
 		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
 
 		glm::mat4 modelMatrix() const {
-			glm::mat4 m = glm::mat4(1.0f);
-			m = glm::translate(m, position);
-			m *= glm::mat4_cast(rotation);
-			m = glm::scale(m, scale);
-			return m;
+			return composeTRS(position, rotation, scale);
 		}
 
 		glm::mat4 modelMatrixEuler() const {
-			glm::mat4 m = glm::mat4(1.0f);
-			m = glm::translate(m, position);
-			m *= glm::mat4_cast(glm::quat(rotEuler));
-			m = glm::scale(m, scale);
-			return m;
+			return composeTRS(position, glm::quat(rotEuler), scale);
+		}
+	};
+
+	//Transform that keeps its last matrices and Euler rotation, rebuilt only when the fields they came from change.
+	//Every read compares the current fields with the cached inputs, so fields can still be written directly.
+	//Kept out of Transform so Joint and SceneGraph nodes stay small. Not thread safe, reads write the cache.
+	class CachedTransform : public Transform {
+	public:
+		glm::quat eulerRotation() const {
+			if (!m_eulerValid || m_eulerAngles != rotEuler) {
+				m_eulerAngles = rotEuler;
+				m_eulerRotation = glm::quat(rotEuler);
+				m_eulerValid = true;
+			}
+			return m_eulerRotation;
+		}
+
+		glm::mat4 modelMatrix() const {
+			if (!m_matrix.valid || m_matrix.position != position || m_matrix.rotation != rotation || m_matrix.scale != scale) {
+				m_matrix.set(position, rotation, scale);
+			}
+			return m_matrix.matrix;
 		}
+
+		//Cached apart from modelMatrix, alternating between the two rebuilds neither
+		glm::mat4 modelMatrixEuler() const {
+			glm::quat r = eulerRotation();
+			if (!m_matrixEuler.valid || m_matrixEuler.position != position || m_matrixEuler.rotation != r || m_matrixEuler.scale != scale) {
+				m_matrixEuler.set(position, r, scale);
+			}
+			return m_matrixEuler.matrix;
+		}
+
+	private:
+		struct CachedMatrix {
+			bool valid = false;
+			glm::vec3 position;
+			glm::quat rotation;
+			glm::vec3 scale;
+			glm::mat4 matrix;
+
+			void set(const glm::vec3& p, const glm::quat& r, const glm::vec3& s) {
+				position = p;
+				rotation = r;
+				scale = s;
+				matrix = composeTRS(p, r, s);
+				valid = true;
+			}
+		};
+
+		mutable bool m_eulerValid = false;
+		mutable glm::vec3 m_eulerAngles;
+		mutable glm::quat m_eulerRotation;
+		mutable CachedMatrix m_matrix;
+		mutable CachedMatrix m_matrixEuler;
 	};
 }
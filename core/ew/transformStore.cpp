@@ -0,0 +1,217 @@
+#include "transformStore.h"
+#include "alignedMemory.h"
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define EW_TRANSFORM_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EW_TRANSFORM_SSE 1
+#endif
+
+namespace ew {
+	static const size_t CHANNEL_ALIGNMENT = 32;
+
+	TransformStore::TransformStore(int capacity)
+	{
+		reserve(capacity);
+	}
+	TransformStore::~TransformStore()
+	{
+		if (m_block != nullptr) {
+			alignedFree(m_block);
+		}
+	}
+	void TransformStore::reserve(int capacity)
+	{
+		if (capacity <= m_capacity) {
+			return;
+		}
+		//Round up so every channel starts 32-byte aligned
+		capacity = (capacity + 7) & ~7;
+		void* block = alignedAlloc(sizeof(float) * NUM_CHANNELS * capacity, CHANNEL_ALIGNMENT);
+		float* channels[NUM_CHANNELS];
+		for (int c = 0; c < NUM_CHANNELS; c++) {
+			channels[c] = (float*)block + (size_t)c * capacity;
+			if (m_size > 0) {
+				memcpy(channels[c], m_channels[c], sizeof(float) * m_size);
+			}
+		}
+		if (m_block != nullptr) {
+			alignedFree(m_block);
+		}
+		m_block = block;
+		memcpy(m_channels, channels, sizeof(channels));
+		m_capacity = capacity;
+	}
+	int TransformStore::add(const Transform& transform)
+	{
+		if (m_size == m_capacity) {
+			reserve(m_capacity > 0 ? m_capacity * 2 : 64);
+		}
+		m_size++;
+		set(m_size - 1, transform);
+		return m_size - 1;
+	}
+	void TransformStore::set(int index, const Transform& transform)
+	{
+		const float values[NUM_CHANNELS] = {
+			transform.position.x, transform.position.y, transform.position.z,
+			transform.rotation.x, transform.rotation.y, transform.rotation.z, transform.rotation.w,
+			transform.scale.x, transform.scale.y, transform.scale.z
+		};
+		for (int c = 0; c < NUM_CHANNELS; c++) {
+			m_channels[c][index] = values[c];
+		}
+	}
+	Transform TransformStore::get(int index) const
+	{
+		Transform transform;
+		transform.position = glm::vec3(m_channels[POSITION_X][index], m_channels[POSITION_Y][index], m_channels[POSITION_Z][index]);
+		transform.rotation = glm::quat(m_channels[ROTATION_W][index], m_channels[ROTATION_X][index], m_channels[ROTATION_Y][index], m_channels[ROTATION_Z][index]);
+		transform.scale = glm::vec3(m_channels[SCALE_X][index], m_channels[SCALE_Y][index], m_channels[SCALE_Z][index]);
+		return transform;
+	}
+	int TransformStore::removeSwap(int index)
+	{
+		int last = m_size - 1;
+		if (index != last) {
+			for (int c = 0; c < NUM_CHANNELS; c++) {
+				m_channels[c][index] = m_channels[c][last];
+			}
+		}
+		m_size--;
+		return last;
+	}
+
+#if defined(EW_TRANSFORM_AVX)
+	//Rotation * scale columns of 8 transforms, same operation order as glm::mat3_cast
+	static void rotationScale8(const float* const* ch, int i, __m256 out[9])
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 two = _mm256_set1_ps(2.0f);
+		__m256 x = _mm256_loadu_ps(ch[TransformStore::ROTATION_X] + i);
+		__m256 y = _mm256_loadu_ps(ch[TransformStore::ROTATION_Y] + i);
+		__m256 z = _mm256_loadu_ps(ch[TransformStore::ROTATION_Z] + i);
+		__m256 w = _mm256_loadu_ps(ch[TransformStore::ROTATION_W] + i);
+		__m256 sx = _mm256_loadu_ps(ch[TransformStore::SCALE_X] + i);
+		__m256 sy = _mm256_loadu_ps(ch[TransformStore::SCALE_Y] + i);
+		__m256 sz = _mm256_loadu_ps(ch[TransformStore::SCALE_Z] + i);
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xz = _mm256_mul_ps(x, z), xy = _mm256_mul_ps(x, y), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+		out[0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+		out[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+		out[2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+		out[3] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+		out[4] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+		out[5] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+		out[6] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+		out[7] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+		out[8] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+	}
+
+	//Turns one matrix column held as x/y/z/w lanes of 8 transforms into per-transform columns.
+	//lo holds transforms 0-3, hi transforms 4-7, as 128-bit halves.
+	static void transposeColumn8(__m256 x, __m256 y, __m256 z, __m256 w, __m256 out[4])
+	{
+		__m256 t0 = _mm256_unpacklo_ps(x, y);
+		__m256 t1 = _mm256_unpackhi_ps(x, y);
+		__m256 t2 = _mm256_unpacklo_ps(z, w);
+		__m256 t3 = _mm256_unpackhi_ps(z, w);
+		out[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)); //Transforms 0 and 4
+		out[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)); //1 and 5
+		out[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)); //2 and 6
+		out[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)); //3 and 7
+	}
+#elif defined(EW_TRANSFORM_SSE)
+	static void rotationScale4(const float* const* ch, int i, __m128 out[9])
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		__m128 x = _mm_loadu_ps(ch[TransformStore::ROTATION_X] + i);
+		__m128 y = _mm_loadu_ps(ch[TransformStore::ROTATION_Y] + i);
+		__m128 z = _mm_loadu_ps(ch[TransformStore::ROTATION_Z] + i);
+		__m128 w = _mm_loadu_ps(ch[TransformStore::ROTATION_W] + i);
+		__m128 sx = _mm_loadu_ps(ch[TransformStore::SCALE_X] + i);
+		__m128 sy = _mm_loadu_ps(ch[TransformStore::SCALE_Y] + i);
+		__m128 sz = _mm_loadu_ps(ch[TransformStore::SCALE_Z] + i);
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xz = _mm_mul_ps(x, z), xy = _mm_mul_ps(x, y), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+		out[0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+		out[1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+		out[2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+		out[3] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+		out[4] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+		out[5] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+		out[6] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+		out[7] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+		out[8] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+	}
+#endif
+
+	void TransformStore::computeModelMatrices(glm::mat4* out, int begin, int end) const
+	{
+		const float* const* ch = m_channels;
+		int i = begin;
+#if defined(EW_TRANSFORM_AVX)
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		for (; i + 8 <= end; i += 8) {
+			__m256 r[9];
+			rotationScale8(ch, i, r);
+			__m256 c0[4], c1[4], c2[4], c3[4];
+			transposeColumn8(r[0], r[1], r[2], zero, c0);
+			transposeColumn8(r[3], r[4], r[5], zero, c1);
+			transposeColumn8(r[6], r[7], r[8], zero, c2);
+			transposeColumn8(_mm256_loadu_ps(ch[POSITION_X] + i), _mm256_loadu_ps(ch[POSITION_Y] + i), _mm256_loadu_ps(ch[POSITION_Z] + i), one, c3);
+			//Each matrix is written as two 32-byte stores: columns 0-1, then 2-3
+			for (int k = 0; k < 4; k++) {
+				float* low = (float*)&out[i + k];
+				float* high = (float*)&out[i + k + 4];
+				_mm256_storeu_ps(low, _mm256_permute2f128_ps(c0[k], c1[k], 0x20));
+				_mm256_storeu_ps(low + 8, _mm256_permute2f128_ps(c2[k], c3[k], 0x20));
+				_mm256_storeu_ps(high, _mm256_permute2f128_ps(c0[k], c1[k], 0x31));
+				_mm256_storeu_ps(high + 8, _mm256_permute2f128_ps(c2[k], c3[k], 0x31));
+			}
+		}
+#elif defined(EW_TRANSFORM_SSE)
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		for (; i + 4 <= end; i += 4) {
+			__m128 r[9];
+			rotationScale4(ch, i, r);
+			__m128 columns[4][4] = {
+				{ r[0], r[1], r[2], zero },
+				{ r[3], r[4], r[5], zero },
+				{ r[6], r[7], r[8], zero },
+				{ _mm_loadu_ps(ch[POSITION_X] + i), _mm_loadu_ps(ch[POSITION_Y] + i), _mm_loadu_ps(ch[POSITION_Z] + i), one }
+			};
+			for (int c = 0; c < 4; c++) {
+				_MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+				for (int k = 0; k < 4; k++) {
+					_mm_storeu_ps(&out[i + k][c][0], columns[c][k]);
+				}
+			}
+		}
+#endif
+		for (; i < end; i++) {
+			out[i] = composeTRS(
+				glm::vec3(ch[POSITION_X][i], ch[POSITION_Y][i], ch[POSITION_Z][i]),
+				glm::quat(ch[ROTATION_W][i], ch[ROTATION_X][i], ch[ROTATION_Y][i], ch[ROTATION_Z][i]),
+				glm::vec3(ch[SCALE_X][i], ch[SCALE_Y][i], ch[SCALE_Z][i])
+			);
+		}
+	}
+
+	JobHandle TransformStore::computeModelMatricesAsync(JobSystem& jobs, glm::mat4* out, int batchSize, const JobHandle& dependency) const
+	{
+		//Whole SIMD groups per batch so only the last batch has a scalar tail
+		batchSize = (batchSize + 7) & ~7;
+		return jobs.parallelFor(m_size, batchSize, [this, out](int begin, int end) {
+			computeModelMatrices(out, begin, end);
+		}, dependency);
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "transform.h"
+#include "jobSystem.h"
+
+namespace ew {
+	//Transforms of many objects as structure of arrays: one float array per component,
+	//32-byte aligned, so model matrices can be built 8 (AVX) or 4 (SSE) objects at a time.
+	//Matrices come out in the same layout and with the same values as Transform::modelMatrix,
+	//ready to be written straight into an InstanceBuffer.
+	class TransformStore {
+	public:
+		enum Channel {
+			POSITION_X, POSITION_Y, POSITION_Z,
+			ROTATION_X, ROTATION_Y, ROTATION_Z, ROTATION_W,
+			SCALE_X, SCALE_Y, SCALE_Z,
+			NUM_CHANNELS
+		};
+		static const int BATCH_SIZE = 4096; //Transforms per job
+
+		TransformStore(int capacity = 0);
+		~TransformStore();
+		TransformStore(const TransformStore&) = delete;
+		TransformStore& operator=(const TransformStore&) = delete;
+
+		//Returns the new transform's index
+		int add(const Transform& transform);
+		void set(int index, const Transform& transform);
+		Transform get(int index)const;
+		//Moves the last transform into index, returns the index it moved from (or index if it was the last)
+		int removeSwap(int index);
+		void clear() { m_size = 0; }
+		void reserve(int capacity);
+
+		//Direct access for bulk updates, size() entries each
+		inline float* channel(Channel c) { return m_channels[c]; }
+		inline const float* channel(Channel c)const { return m_channels[c]; }
+		inline int size()const { return m_size; }
+		inline int capacity()const { return m_capacity; }
+
+		//Model matrices of transforms [begin, end) into out[begin, end)
+		void computeModelMatrices(glm::mat4* out, int begin, int end)const;
+		void computeModelMatrices(glm::mat4* out)const { computeModelMatrices(out, 0, m_size); }
+		//Same, split over the job system. out and the store must not change until the handle completes.
+		JobHandle computeModelMatricesAsync(JobSystem& jobs, glm::mat4* out, int batchSize = BATCH_SIZE, const JobHandle& dependency = nullptr)const;
+	private:
+		void* m_block = nullptr; //Every channel in one allocation
+		float* m_channels[NUM_CHANNELS] = {};
+		int m_size = 0;
+		int m_capacity = 0; //Always a multiple of 8
+	};
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "simd.h"
+
+// Affine transform stored as the top three rows of a 4x4 matrix, the fourth row
+// is always (0, 0, 0, 1). 48 bytes instead of a glm::mat4's 64, and composing two
+// of them skips the fourth row entirely.
+// Row r holds the linear part's row r in x/y/z and the translation's r component in w,
+// so every row is one SSE register. Convert with toMat4() only where a mat4 is
+// needed (shader uniforms, vertex buffers).
+
+namespace ir {
+	struct alignas(16) Affine {
+		float m[3][4];
+	};
+
+	inline Affine affineIdentity() {
+		return { {
+			{ 1, 0, 0, 0 },
+			{ 0, 1, 0, 0 },
+			{ 0, 0, 1, 0 }
+		} };
+	}
+
+	// Drops the fourth row, which must be (0, 0, 0, 1)
+	inline Affine affineFromMat4(const glm::mat4& mat) {
+		Affine a;
+		for (int r = 0; r < 3; r++) {
+			for (int c = 0; c < 4; c++) {
+				a.m[r][c] = mat[c][r];
+			}
+		}
+		return a;
+	}
+
+	inline glm::mat4 toMat4(const Affine& a) {
+		return glm::mat4(
+			a.m[0][0], a.m[1][0], a.m[2][0], 0.0f,
+			a.m[0][1], a.m[1][1], a.m[2][1], 0.0f,
+			a.m[0][2], a.m[1][2], a.m[2][2], 0.0f,
+			a.m[0][3], a.m[1][3], a.m[2][3], 1.0f
+		);
+	}
+
+	// translate * rotate * scale, the same matrix as ew::Transform::modelMatrix
+	inline Affine affineTRS(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale) {
+		const float x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
+		const float xx = x * x, yy = y * y, zz = z * z;
+		const float xy = x * y, xz = x * z, yz = y * z;
+		const float wx = w * x, wy = w * y, wz = w * z;
+		return { {
+			{ (1 - 2 * (yy + zz)) * scale.x, 2 * (xy - wz) * scale.y, 2 * (xz + wy) * scale.z, translation.x },
+			{ 2 * (xy + wz) * scale.x, (1 - 2 * (xx + zz)) * scale.y, 2 * (yz - wx) * scale.z, translation.y },
+			{ 2 * (xz - wy) * scale.x, 2 * (yz + wx) * scale.y, (1 - 2 * (xx + yy)) * scale.z, translation.z }
+		} };
+	}
+
+	inline Affine affineTranslate(const glm::vec3& translation) {
+		return affineTRS(translation, glm::quat(1, 0, 0, 0), glm::vec3(1, 1, 1));
+	}
+
+	inline Affine affineRotate(const glm::quat& rotation) {
+		return affineTRS(glm::vec3(0, 0, 0), rotation, glm::vec3(1, 1, 1));
+	}
+
+	inline Affine affineScale(const glm::vec3& scale) {
+		return affineTRS(glm::vec3(0, 0, 0), glm::quat(1, 0, 0, 0), scale);
+	}
+
+	inline glm::vec3 transformPoint(const Affine& a, const glm::vec3& p) {
+		return glm::vec3(
+			a.m[0][0] * p.x + a.m[0][1] * p.y + a.m[0][2] * p.z + a.m[0][3],
+			a.m[1][0] * p.x + a.m[1][1] * p.y + a.m[1][2] * p.z + a.m[1][3],
+			a.m[2][0] * p.x + a.m[2][1] * p.y + a.m[2][2] * p.z + a.m[2][3]
+		);
+	}
+
+#if defined(IR_SIMD_AVX) || defined(IR_SIMD_SSE)
+	namespace affine {
+		// (a.y, a.z, a.x, a.w) and (a.z, a.x, a.y, a.w)
+		inline __m128 yzx(__m128 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)); }
+		inline __m128 zxy(__m128 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2)); }
+		template<int I>
+		inline __m128 splat(__m128 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(I, I, I, I)); }
+
+		// cross product of the xyz parts, w comes out as 0
+		inline __m128 cross(__m128 a, __m128 b) {
+			return _mm_sub_ps(_mm_mul_ps(yzx(a), zxy(b)), _mm_mul_ps(zxy(a), yzx(b)));
+		}
+
+		// Row of a * b: x * b0 + y * b1 + z * b2 + w * (0, 0, 0, 1)
+		inline __m128 composeRow(__m128 row, __m128 b0, __m128 b1, __m128 b2, __m128 wMask) {
+			__m128 r = _mm_mul_ps(splat<0>(row), b0);
+			r = _mm_add_ps(r, _mm_mul_ps(splat<1>(row), b1));
+			r = _mm_add_ps(r, _mm_mul_ps(splat<2>(row), b2));
+			return _mm_add_ps(r, _mm_and_ps(splat<3>(row), wMask));
+		}
+	}
+#endif
+
+	// a * b, b is applied first
+	inline Affine compose(const Affine& a, const Affine& b) {
+		Affine out;
+#if defined(IR_SIMD_AVX)
+		// rows 0 and 1 together in one register, row 2 on its own
+		const __m256 wMask2 = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+		__m256 a01 = _mm256_loadu_ps(a.m[0]);
+		__m256 b0 = _mm256_broadcast_ps((const __m128*)b.m[0]);
+		__m256 b1 = _mm256_broadcast_ps((const __m128*)b.m[1]);
+		__m256 b2 = _mm256_broadcast_ps((const __m128*)b.m[2]);
+		__m256 r01 = _mm256_mul_ps(_mm256_permute_ps(a01, 0x00), b0);
+		r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_permute_ps(a01, 0x55), b1));
+		r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_permute_ps(a01, 0xAA), b2));
+		r01 = _mm256_add_ps(r01, _mm256_and_ps(_mm256_permute_ps(a01, 0xFF), wMask2));
+		_mm256_storeu_ps(out.m[0], r01);
+		const __m128 wMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+		_mm_store_ps(out.m[2], affine::composeRow(_mm_load_ps(a.m[2]), _mm256_castps256_ps128(b0), _mm256_castps256_ps128(b1), _mm256_castps256_ps128(b2), wMask));
+#elif defined(IR_SIMD_SSE)
+		const __m128 wMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+		__m128 b0 = _mm_load_ps(b.m[0]);
+		__m128 b1 = _mm_load_ps(b.m[1]);
+		__m128 b2 = _mm_load_ps(b.m[2]);
+		for (int r = 0; r < 3; r++) {
+			_mm_store_ps(out.m[r], affine::composeRow(_mm_load_ps(a.m[r]), b0, b1, b2, wMask));
+		}
+#else
+		for (int r = 0; r < 3; r++) {
+			for (int c = 0; c < 4; c++) {
+				float v = a.m[r][0] * b.m[0][c];
+				v += a.m[r][1] * b.m[1][c];
+				v += a.m[r][2] * b.m[2][c];
+				out.m[r][c] = (c == 3) ? v + a.m[r][3] : v;
+			}
+		}
+#endif
+		return out;
+	}
+
+	// Inverse of an invertible affine transform (no zero scale)
+	inline Affine inverse(const Affine& a) {
+		Affine out;
+#if defined(IR_SIMD_AVX) || defined(IR_SIMD_SSE)
+		using namespace affine;
+		__m128 r0 = _mm_load_ps(a.m[0]);
+		__m128 r1 = _mm_load_ps(a.m[1]);
+		__m128 r2 = _mm_load_ps(a.m[2]);
+		// columns of the adjugate
+		__m128 c0 = cross(r1, r2);
+		__m128 c1 = cross(r2, r0);
+		__m128 c2 = cross(r0, r1);
+		__m128 det = _mm_mul_ps(r0, c0);
+		det = _mm_add_ps(_mm_add_ps(splat<0>(det), splat<1>(det)), splat<2>(det));
+		__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+		c0 = _mm_mul_ps(c0, invDet);
+		c1 = _mm_mul_ps(c1, invDet);
+		c2 = _mm_mul_ps(c2, invDet);
+		// -(inverse linear part * translation)
+		__m128 t = _mm_mul_ps(c0, splat<3>(r0));
+		t = _mm_add_ps(t, _mm_mul_ps(c1, splat<3>(r1)));
+		t = _mm_add_ps(t, _mm_mul_ps(c2, splat<3>(r2)));
+		t = _mm_sub_ps(_mm_setzero_ps(), t);
+		_MM_TRANSPOSE4_PS(c0, c1, c2, t);
+		_mm_store_ps(out.m[0], c0);
+		_mm_store_ps(out.m[1], c1);
+		_mm_store_ps(out.m[2], c2);
+#else
+		const float(*m)[4] = a.m;
+		float c[3][3] = {
+			{ m[1][1] * m[2][2] - m[1][2] * m[2][1], m[1][2] * m[2][0] - m[1][0] * m[2][2], m[1][0] * m[2][1] - m[1][1] * m[2][0] },
+			{ m[2][1] * m[0][2] - m[2][2] * m[0][1], m[2][2] * m[0][0] - m[2][0] * m[0][2], m[2][0] * m[0][1] - m[2][1] * m[0][0] },
+			{ m[0][1] * m[1][2] - m[0][2] * m[1][1], m[0][2] * m[1][0] - m[0][0] * m[1][2], m[0][0] * m[1][1] - m[0][1] * m[1][0] }
+		};
+		float invDet = 1.0f / (m[0][0] * c[0][0] + m[0][1] * c[0][1] + m[0][2] * c[0][2]);
+		for (int r = 0; r < 3; r++) {
+			for (int k = 0; k < 3; k++) {
+				out.m[r][k] = c[k][r] * invDet;
+			}
+		}
+		for (int r = 0; r < 3; r++) {
+			out.m[r][3] = -(out.m[r][0] * m[0][3] + out.m[r][1] * m[1][3] + out.m[r][2] * m[2][3]);
+		}
+#endif
+		return out;
+	}
+}
@@ -1,6 +1,17 @@
+#pragma once
 #include <glm/glm.hpp>
 #include "../ew/transform.h"
+#include "../ew/jobSystem.h"
+#include "../ew/alignedMemory.h"
+#include "affine.h"
 #include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <new>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <unordered_map>
 #include <imgui.h>
 
 namespace ir {
@@ -9,34 +20,47 @@ namespace ir {
 		glm::quat rotation;
 		glm::vec3 translation;
 		glm::vec3 scale;
+
+		JointPose() {
+			rotation = glm::quat(1, 0, 0, 0);
+			translation = glm::vec3(0, 0, 0);
+			scale = glm::vec3(1, 1, 1);
+		}
+
+		JointPose(const ew::Transform& transform) {
+			rotation = transform.rotation;
+			translation = transform.position;
+			scale = transform.scale;
+		}
+
+		// Same matrix as ew::Transform::modelMatrix
+		Affine toAffine() const {
+			return affineTRS(translation, rotation, scale);
+		}
 	};
 
 	struct Joint {
 		const char* name;
 		Joint* parent;
-		std::vector<Joint*> children;
+		Joint** children; // numChildren entries in the skeleton's shared child array
 		unsigned int numChildren;
 		ew::Transform localPose;
 		ew::Transform globalPose;
-		glm::mat4 localMat4;
-		glm::mat4 globalMat4;
+		Affine localMat;
+		Affine globalMat; // convert with toMat4() for drawing
 		bool isClicked = false;
 		
 		Joint() {
-
-		}
-
-		Joint(const char* theName) {
-			name = theName;
+			name = nullptr;
 			parent = nullptr;
+			children = nullptr;
+			numChildren = 0;
 		}
 
-		Joint(const char* theName, Joint* theParent) {
+		Joint(const char* theName) : Joint() {
 			name = theName;
-			parent = theParent;
-			parent->children.push_back(this);
 		}
-		
+
 		void handleUI() {
 			ImGuiTreeNodeFlags flag = ImGuiTreeNodeFlags_DefaultOpen;
 			if (name != nullptr) {
@@ -44,8 +68,8 @@ namespace ir {
 					if (ImGui::IsItemClicked()) {
 						isClicked = true;
 					}
-					for each(Joint * j in children) {
-						j->handleUI();
+					for (unsigned int c = 0; c < numChildren; c++) {
+						children[c]->handleUI();
 					}
 					ImGui::TreePop();
 				}
@@ -58,17 +82,48 @@ namespace ir {
 
 		}
 
-		void inspectorUI() {
+		// Returns true if localPose was edited
+		bool inspectorUI() {
+			bool changed = false;
 			ImGui::Text(name);
-			ImGui::DragFloat3("Position", &localPose.position.x, 0.1f);
-			ImGui::DragFloat3("Rotation", &localPose.rotEuler.x, 0.1f);
-			ImGui::DragFloat3("Scale", &localPose.scale.x, 0.1f);
+			changed |= ImGui::DragFloat3("Position", &localPose.position.x, 0.1f);
+			// Euler angles are only for editing, FK reads the quaternion
+			if (ImGui::DragFloat3("Rotation", &localPose.rotEuler.x, 0.1f)) {
+				localPose.rotation = glm::quat(localPose.rotEuler);
+				changed = true;
+			}
+			changed |= ImGui::DragFloat3("Scale", &localPose.scale.x, 0.1f);
+			return changed;
 		}
 	};
 
+	// One allocation holding a built skeleton's joints, child lists and names:
+	// [Joint x jointCount | Joint* x children | interned names]
+	struct SkeletonStorage {
+		void* block = nullptr;
+		Joint* joints = nullptr;
+		int jointCount = 0;
+
+		SkeletonStorage(size_t bytes) {
+			block = ew::alignedAlloc(bytes, alignof(Joint));
+		}
+
+		~SkeletonStorage() {
+			for (int i = 0; i < jointCount; i++) {
+				joints[i].~Joint();
+			}
+			ew::alignedFree(block);
+		}
+
+		SkeletonStorage(const SkeletonStorage&) = delete;
+		SkeletonStorage& operator=(const SkeletonStorage&) = delete;
+	};
+
 	struct Skeleton {
 		unsigned int jointCount;
 		std::vector<Joint*> joints;
+		// set by SkeletonBuilder, the joints are freed with the last skeleton sharing it
+		std::shared_ptr<SkeletonStorage> storage;
 
 		void handleUI() {
 			ImGuiTreeNodeFlags flag = ImGuiTreeNodeFlags_DefaultOpen;
@@ -84,30 +139,434 @@ namespace ir {
 		}
 	};
 
-	struct SkeletonPose {
-		Skeleton* skeleton;
-		JointPose* localPoses;
-		glm::mat4x4* globalPoses;
+#pragma region Skeleton Builder
+	// Describes a skeleton joint by joint, then build() lays it out in one allocation.
+	// Children are ranges of a shared array, names are stored once per distinct name.
+	// A builder can be cleared and reused, its own arrays keep their capacity.
+	struct SkeletonBuilder {
+		std::vector<int> parents;
+		std::vector<int> nameIds; // index into nameOffsets, -1 for nameless joints
+		std::vector<ew::Transform> localPoses;
+		std::vector<int> nameOffsets; // start of each distinct name in nameChars
+		std::vector<char> nameChars; // null terminated names back to back
+		std::unordered_map<std::string, int> nameLookup;
+
+		int size() const {
+			return (int)parents.size();
+		}
+
+		// Returns the new joint's index, or -1 if parent has not been added yet.
+		// Parents must be added before their children.
+		int addJoint(const char* name, int parent = -1, const ew::Transform& localPose = ew::Transform()) {
+			if (parent < -1 || parent >= size()) {
+				return -1;
+			}
+			parents.push_back(parent);
+			nameIds.push_back(name != nullptr ? internName(name) : -1);
+			localPoses.push_back(localPose);
+			return size() - 1;
+		}
+
+		int internName(const char* name) {
+			auto it = nameLookup.find(name);
+			if (it != nameLookup.end()) {
+				return it->second;
+			}
+			int id = (int)nameOffsets.size();
+			nameOffsets.push_back((int)nameChars.size());
+			nameChars.insert(nameChars.end(), name, name + std::strlen(name) + 1);
+			nameLookup.emplace(name, id);
+			return id;
+		}
+
+		void clear() {
+			parents.clear();
+			nameIds.clear();
+			localPoses.clear();
+			nameOffsets.clear();
+			nameChars.clear();
+			nameLookup.clear();
+		}
+
+		Skeleton build() const {
+			const int count = size();
+			int childCount = 0;
+			for (int i = 0; i < count; i++) {
+				childCount += parents[i] >= 0;
+			}
+			const size_t jointBytes = sizeof(Joint) * count;
+			const size_t childBytes = sizeof(Joint*) * childCount;
+			auto storage = std::make_shared<SkeletonStorage>(jointBytes + childBytes + nameChars.size());
+			char* block = (char*)storage->block;
+			Joint* joints = (Joint*)block;
+			Joint** childArray = (Joint**)(block + jointBytes);
+			char* names = block + jointBytes + childBytes;
+			if (!nameChars.empty()) {
+				std::memcpy(names, nameChars.data(), nameChars.size());
+			}
+
+			for (int i = 0; i < count; i++) {
+				new (&joints[i]) Joint(nameIds[i] >= 0 ? names + nameOffsets[nameIds[i]] : nullptr);
+				joints[i].localPose = localPoses[i];
+				if (parents[i] >= 0) {
+					joints[i].parent = &joints[parents[i]];
+					joints[parents[i]].numChildren++;
+				}
+			}
+			storage->joints = joints;
+			storage->jointCount = count;
+
+			// each joint's children start where the previous joint's end, filled in joint order
+			int next = 0;
+			for (int i = 0; i < count; i++) {
+				joints[i].children = childArray + next;
+				next += joints[i].numChildren;
+				joints[i].numChildren = 0;
+			}
+			for (int i = 0; i < count; i++) {
+				if (parents[i] >= 0) {
+					Joint& parent = joints[parents[i]];
+					parent.children[parent.numChildren++] = &joints[i];
+				}
+			}
+
+			Skeleton skeleton;
+			skeleton.jointCount = count;
+			skeleton.joints.resize(count);
+			for (int i = 0; i < count; i++) {
+				skeleton.joints[i] = &joints[i];
+			}
+			skeleton.storage = storage;
+			return skeleton;
+		}
 	};
+#pragma endregion
 
-	void solveFK(Joint* joint) {
-		joint->localMat4 = joint->localPose.modelMatrixEuler();
+	// Recursive FK from joint down, for joints that are not part of a FlatSkeleton
+	inline void solveFK(Joint* joint) {
+		joint->localMat = JointPose(joint->localPose).toAffine();
 		if (joint->parent == nullptr) {
-			joint->globalMat4 = joint->localMat4;
+			joint->globalMat = joint->localMat;
 		}
 		else {
-			joint->globalMat4 = joint->parent->globalMat4 * joint->localMat4;
+			joint->globalMat = compose(joint->parent->globalMat, joint->localMat);
 		}
-		for each(Joint * j in joint->children) {
-			solveFK(j);
+		for (unsigned int c = 0; c < joint->numChildren; c++) {
+			solveFK(joint->children[c]);
 		}
 	}
 	
-	void solveFK(Skeleton skeleton) {
+	// Each subtree is solved once, starting from the roots
+	inline void solveFK(const Skeleton& skeleton) {
 		for each(Joint* j in skeleton.joints) {
-			solveFK(j);
+			if (j->parent == nullptr) {
+				solveFK(j);
+			}
 		}
 	}
 
-	
+#pragma region Flat Skeleton
+	// Skeleton laid out for FK: joints in parent before child order,
+	// parents as indices and poses in contiguous arrays.
+	// Changing a local pose marks the joint dirty, solveFK only recomputes
+	// dirty joints and their descendants.
+	struct FlatSkeleton {
+		std::vector<Joint*> joints; // joint each entry was built from
+		std::vector<int> parents; // -1 for roots, otherwise always lower than the joint's own index
+		std::vector<int> subtreeEnds; // one past the joint's last descendant
+		std::vector<JointPose> localPoses;
+		std::vector<Affine> localMats;
+		std::vector<Affine> globalMats;
+		std::vector<uint8_t> dirty;
+		bool anyDirty = false;
+		int recomputedJoints = 0; // joints solved by the last solveFK
+
+		int size() const {
+			return (int)parents.size();
+		}
+
+		// Returns -1 if joint is not part of this skeleton
+		int indexOf(const Joint* joint) const {
+			for (int i = 0; i < size(); i++) {
+				if (joints[i] == joint) {
+					return i;
+				}
+			}
+			return -1;
+		}
+
+		void markDirty(int index) {
+			dirty[index] = 1;
+			anyDirty = true;
+		}
+
+		void setLocalPose(int index, const JointPose& pose) {
+			localPoses[index] = pose;
+			markDirty(index);
+		}
+
+		// Copies one joint's edited local pose in
+		void readLocalPose(int index) {
+			setLocalPose(index, JointPose(joints[index]->localPose));
+		}
+
+		// Call after editing joint->localPose, does nothing for joints outside the skeleton
+		void jointChanged(const Joint* joint) {
+			int index = indexOf(joint);
+			if (index >= 0) {
+				readLocalPose(index);
+			}
+		}
+
+		// Copies every joint's local pose in
+		void readLocalPoses() {
+			for (int i = 0; i < size(); i++) {
+				readLocalPose(i);
+			}
+		}
+
+		// Copies solved matrices back to the joints
+		void writeGlobalMats() {
+			for (int i = 0; i < size(); i++) {
+				joints[i]->localMat = localMats[i];
+				joints[i]->globalMat = globalMats[i];
+			}
+		}
+	};
+
+	// Orders the joints depth first from each root, so every subtree is one contiguous range
+	inline FlatSkeleton flatten(const Skeleton& skeleton) {
+		FlatSkeleton flat;
+		std::vector<std::pair<Joint*, int>> stack; // joint, flat index of its parent
+		for (int r = (int)skeleton.joints.size() - 1; r >= 0; r--) {
+			if (skeleton.joints[r]->parent == nullptr) {
+				stack.push_back({ skeleton.joints[r], -1 });
+			}
+		}
+		while (!stack.empty()) {
+			Joint* joint = stack.back().first;
+			int parent = stack.back().second;
+			stack.pop_back();
+
+			int index = flat.size();
+			flat.joints.push_back(joint);
+			flat.parents.push_back(parent);
+			flat.localPoses.push_back(JointPose(joint->localPose));
+			// reversed so the first child comes out first
+			for (int c = (int)joint->numChildren - 1; c >= 0; c--) {
+				stack.push_back({ joint->children[c], index });
+			}
+		}
+
+		const int count = flat.size();
+		flat.subtreeEnds.resize(count);
+		for (int i = count - 1; i >= 0; i--) {
+			flat.subtreeEnds[i] = std::max(flat.subtreeEnds[i], i + 1);
+			if (flat.parents[i] >= 0) {
+				flat.subtreeEnds[flat.parents[i]] = std::max(flat.subtreeEnds[flat.parents[i]], flat.subtreeEnds[i]);
+			}
+		}
+		flat.localMats.assign(count, affineIdentity());
+		flat.globalMats.assign(count, affineIdentity());
+		flat.dirty.assign(count, 1); // nothing has been solved yet
+		flat.anyDirty = count > 0;
+		return flat;
+	}
+
+	// One pass in array order, a parent is always solved before its children.
+	// A dirty joint's whole subtree is recomputed, clean subtrees are skipped.
+	inline void solveFK(FlatSkeleton& skeleton) {
+		skeleton.recomputedJoints = 0;
+		if (!skeleton.anyDirty) {
+			return;
+		}
+
+		const int count = skeleton.size();
+		const int* parents = skeleton.parents.data();
+		const int* subtreeEnds = skeleton.subtreeEnds.data();
+		const JointPose* localPoses = skeleton.localPoses.data();
+		Affine* localMats = skeleton.localMats.data();
+		Affine* globalMats = skeleton.globalMats.data();
+		uint8_t* dirty = skeleton.dirty.data();
+
+		int i = 0;
+		while (i < count) {
+			if (!dirty[i]) {
+				i++;
+				continue;
+			}
+			const int start = i;
+			const int end = subtreeEnds[i];
+			for (; i < end; i++) {
+				// descendants keep their cached local matrix unless they were edited as well
+				if (dirty[i]) {
+					localMats[i] = localPoses[i].toAffine();
+					dirty[i] = 0;
+				}
+				globalMats[i] = (parents[i] < 0) ? localMats[i] : compose(globalMats[parents[i]], localMats[i]);
+			}
+			skeleton.recomputedJoints += end - start;
+		}
+		skeleton.anyDirty = false;
+	}
+#pragma endregion
+
+#pragma region Batch FK
+	// One instance of a shared FlatSkeleton. The pose arrays hold skeleton->size() joints
+	// each and are indexed like the skeleton's joints. They usually live in a PoseArena,
+	// but any caller-owned arrays work.
+	struct SkeletonPose {
+		const FlatSkeleton* skeleton = nullptr;
+		JointPose* localPoses = nullptr;
+		Affine* globalPoses = nullptr; // written by solveFK
+		const Affine* previousGlobalPoses = nullptr; // last frame's result when double buffered, safe to read while solving
+	};
+
+	// Full FK for one pose, no dirty tracking
+	inline void solveFK(const SkeletonPose& pose) {
+		const int count = pose.skeleton->size();
+		const int* parents = pose.skeleton->parents.data();
+		for (int i = 0; i < count; i++) {
+			Affine local = pose.localPoses[i].toAffine();
+			pose.globalPoses[i] = (parents[i] < 0) ? local : compose(pose.globalPoses[parents[i]], local);
+		}
+	}
+
+	const int FK_BATCH_SIZE = 16; // skeletons per job
+
+	// Spreads the poses over the job system in batches of batchSize. Every pose only
+	// writes its own globalPoses, so no locking is needed as long as no two poses share
+	// an output buffer. Returns the handle to wait on.
+	inline ew::JobHandle solveFKAsync(ew::JobSystem& jobs, const SkeletonPose* poses, int count, int batchSize = FK_BATCH_SIZE, const ew::JobHandle& dependency = nullptr) {
+		return jobs.parallelFor(count, batchSize, [poses](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				solveFK(poses[i]);
+			}
+		}, dependency);
+	}
+
+	// Same for separate skeletons, each keeps its own dirty tracking
+	inline ew::JobHandle solveFKAsync(ew::JobSystem& jobs, FlatSkeleton* const* skeletons, int count, int batchSize = FK_BATCH_SIZE, const ew::JobHandle& dependency = nullptr) {
+		return jobs.parallelFor(count, batchSize, [skeletons](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				solveFK(*skeletons[i]);
+			}
+		}, dependency);
+	}
+
+	inline void solveFK(ew::JobSystem& jobs, const SkeletonPose* poses, int count, int batchSize = FK_BATCH_SIZE) {
+		jobs.wait(solveFKAsync(jobs, poses, count, batchSize));
+	}
+
+	inline void solveFK(ew::JobSystem& jobs, FlatSkeleton* const* skeletons, int count, int batchSize = FK_BATCH_SIZE) {
+		jobs.wait(solveFKAsync(jobs, skeletons, count, batchSize));
+	}
+#pragma endregion
+
+#pragma region Pose Arena
+	// Pose storage for up to capacity instances of one skeleton, allocated once.
+	// Each instance gets local poses and two global pose buffers in one contiguous block.
+	// solveFK writes the back buffer while the front buffer (previousGlobalPoses) still
+	// holds last frame's result, so uploading can overlap the next frame's FK:
+	//   handle = arena.solveAsync(jobs);
+	//   upload every pose's previousGlobalPoses
+	//   jobs.wait(handle);
+	//   arena.swap();
+	// Pose data never allocates after construction, instances are freed all at once by clear().
+	// Solving on the job system still allocates parallelFor's bookkeeping (handle, shared job,
+	// one job per batch), a few small allocations per call rather than per joint or instance.
+	// solve() without a job system allocates nothing.
+	struct PoseArena {
+		const FlatSkeleton* skeleton = nullptr;
+		std::vector<SkeletonPose> poses; // reserved to capacity, so pointers stay valid
+
+		PoseArena(const FlatSkeleton& theSkeleton, int capacity) {
+			skeleton = &theSkeleton;
+			m_capacity = capacity;
+			const size_t joints = (size_t)skeleton->size();
+			// globals first so every block starts on an Affine boundary
+			m_blockSize = (2 * joints * sizeof(Affine) + joints * sizeof(JointPose) + alignof(Affine) - 1) / alignof(Affine) * alignof(Affine);
+			if (m_blockSize * capacity > 0) {
+				m_memory = (char*)ew::alignedAlloc(m_blockSize * capacity, alignof(Affine));
+			}
+			poses.reserve(capacity);
+		}
+
+		~PoseArena() {
+			if (m_memory != nullptr) {
+				ew::alignedFree(m_memory);
+			}
+		}
+
+		PoseArena(const PoseArena&) = delete;
+		PoseArena& operator=(const PoseArena&) = delete;
+
+		int size() const {
+			return (int)poses.size();
+		}
+
+		int capacity() const {
+			return m_capacity;
+		}
+
+		// New instance in the skeleton's current local pose, nullptr if the arena is full
+		SkeletonPose* create() {
+			if (size() >= m_capacity) {
+				return nullptr;
+			}
+			const int joints = skeleton->size();
+			char* block = m_memory + m_blockSize * poses.size();
+			Affine* front = (Affine*)block;
+			Affine* back = front + joints;
+			JointPose* locals = (JointPose*)(back + joints);
+			for (int i = 0; i < joints; i++) {
+				new (&front[i]) Affine(skeleton->globalMats[i]);
+				new (&back[i]) Affine(skeleton->globalMats[i]);
+				new (&locals[i]) JointPose(skeleton->localPoses[i]);
+			}
+
+			SkeletonPose pose;
+			pose.skeleton = skeleton;
+			pose.localPoses = locals;
+			pose.globalPoses = back;
+			pose.previousGlobalPoses = front;
+			poses.push_back(pose);
+			return &poses.back();
+		}
+
+		// Frees every instance
+		void clear() {
+			poses.clear();
+		}
+
+		// Makes this frame's results the previous frame's, call once FK has finished
+		void swap() {
+			for (SkeletonPose& pose : poses) {
+				Affine* previous = (Affine*)pose.previousGlobalPoses;
+				pose.previousGlobalPoses = pose.globalPoses;
+				pose.globalPoses = previous;
+			}
+		}
+
+		ew::JobHandle solveAsync(ew::JobSystem& jobs, int batchSize = FK_BATCH_SIZE, const ew::JobHandle& dependency = nullptr) {
+			return solveFKAsync(jobs, poses.data(), size(), batchSize, dependency);
+		}
+
+		void solve(ew::JobSystem& jobs, int batchSize = FK_BATCH_SIZE) {
+			jobs.wait(solveAsync(jobs, batchSize));
+		}
+
+		// Every pose on the calling thread
+		void solve() {
+			for (const SkeletonPose& pose : poses) {
+				solveFK(pose);
+			}
+		}
+
+	private:
+		char* m_memory = nullptr;
+		size_t m_blockSize = 0; // bytes per instance
+		int m_capacity = 0;
+	};
+#pragma endregion
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
+#pragma once
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <vector>
+#include <algorithm>
 #include <math.h>
 #include <imgui.h>
 //#include <numbers>
@@ -17,7 +20,7 @@ namespace ir {
 		OUT_BACK
 	}; 
 
-	const char* easingNames[] = {
+	const char* const easingNames[] = {
 		"None",
 		"In Out Elastic",
 		"In Sine",
@@ -26,11 +29,11 @@ namespace ir {
 
 	const float PI = 3.141592653;
 
-	float noEasing(float x) {
+	inline float noEasing(float x) {
 		return x;
 	}
 
-	float easeInOutElastic(float x) {
+	inline float easeInOutElastic(float x) {
 		const float c5 = (2 * PI) / 4.5;
 
 		return
@@ -40,11 +43,11 @@ namespace ir {
 			(pow(2, -20 * x + 10) * sin((20 * x - 11.125) * c5)) / 2 + 1;
 	}
 
-	float easeInSine(float x) {
+	inline float easeInSine(float x) {
 		return 1 - cos((x * PI) / 2);
 	}
 
-	float easeOutBack(float x) {
+	inline float easeOutBack(float x) {
 		const float c1 = 1.70158;
 		const float c3 = c1 + 1;
 
@@ -55,7 +58,7 @@ namespace ir {
 
 	const std::vector<EasingFunc*> EASING_FUNCTIONS = { noEasing, easeInOutElastic, easeInSine, easeOutBack};
 
-	float ease(float val, int type) {
+	inline float ease(float val, int type) {
 		return EASING_FUNCTIONS[type](val);
 	}
 #pragma endregion
@@ -81,215 +84,177 @@ namespace ir {
 		}
 	};
 
-	struct AnimationClip {
-		float duration;
-		std::vector<Vec3Key> positionKeys;
-		std::vector<Vec3Key> rotationKeys;
-		std::vector<Vec3Key> scaleKeys;
+	// Rotation key, interpolated along the shortest arc between neighbouring keys
+	struct QuatKey {
+		glm::quat value;
+		float time;
+		int easeType;
 
-		AnimationClip() {
-			duration = -1;
+		QuatKey() {
+			value = glm::quat(1, 0, 0, 0);
+			time = -1; // ignore frames with -1 time
+			easeType = NONE;
 		}
 
-		int partition(std::vector<Vec3Key>& keys, int low, int high) {
-			float pivot = keys[high].time;
-			int i = (low - 1);
-
-			for (int j = low; j <= high - 1; j++) {
-				if (keys[j].time <= pivot) {
-					i++;
-					std::swap(keys[i], keys[j]);
-				}
-			}
-
-			std::swap(keys[i + 1], keys[high]);
+		QuatKey(glm::quat _value, float _time) {
+			value = _value;
+			time = _time;
+			easeType = NONE;
+		}
 
-			return (i + 1);
+		bool operator==(const QuatKey& other) {
+			return (time == other.time) && (value == other.value);
 		}
+	};
 
-		void sortKeys(std::vector<Vec3Key>& keys, int low, int high) {
-			if (low < high) {
-				int pi = partition(keys, low, high);
+#pragma region Sampling
+	// Remembers which key segment a track was last sampled in, so playback
+	// only has to look at neighbouring keys instead of scanning the track
+	struct KeyCursor {
+		int index = 0;
 
-				sortKeys(keys, low, pi - 1);
-				sortKeys(keys, pi + 1, high);
-			}
+		void reset() {
+			index = 0;
 		}
-
 	};
 
-	struct Animator {
-		AnimationClip* clip;
-		bool isPlaying;
-		float playbackSpeed; // negatives play backwards
-		bool isLooping; // if false, stop once clip.duration is reached
-		float playbackTime; // current time, between 0 and clip.duration
-
-		Animator() {
-			clip = nullptr;
-			isPlaying = false;
-			playbackSpeed = 1;
-			isLooping = false;
-			playbackTime = 0;
+	const int KEY_CURSOR_MAX_STEPS = 4; // keys walked before falling back to a binary search
+
+	// Finds the segment [index, index + 1] of a sorted track that contains time.
+	// timeAt(i) returns the time of key i, so any track layout can share this.
+	// Steps from the cursor while playing forwards or backwards, checks both ends
+	// on a loop wrap and binary searches anything else (seeks).
+	template<typename TimeAt>
+	int seekKey(KeyCursor& cursor, int count, float time, TimeAt timeAt) {
+		if (count < 2) {
+			cursor.index = 0;
+			return 0;
 		}
 
-		~Animator() {
-			delete clip;
-			clip = nullptr;
+		const int last = count - 2; // last valid segment
+		int i = cursor.index;
+		if (i < 0 || i > last) {
+			i = 0; // keys were removed or re-sorted since the last sample
 		}
 
-		bool update(float dt) {
-			if (!isPlaying) {
-				return false;
-			}
-			
-			playbackTime += playbackSpeed * dt;
-
-			if (playbackTime > clip->duration) {
-				if (isLooping) {
-					playbackTime = (playbackTime + dt) - clip->duration;
-				}
-				else {
-					playbackTime = clip->duration;
+		if (time >= timeAt(i)) {
+			for (int step = 0; step < KEY_CURSOR_MAX_STEPS; step++) {
+				if (i == last || time < timeAt(i + 1)) {
+					cursor.index = i;
+					return i;
 				}
+				i++;
 			}
-			if (playbackSpeed < 0 && playbackTime < 0) {
-				if (isLooping) {
-					playbackTime = (playbackTime - dt) + clip->duration;
+		}
+		else {
+			for (int step = 0; step < KEY_CURSOR_MAX_STEPS; step++) {
+				if (i == 0) {
+					cursor.index = 0;
+					return 0;
 				}
-				else {
-					playbackTime = 0;
+				i--;
+				if (time >= timeAt(i)) {
+					cursor.index = i;
+					return i;
 				}
 			}
-			return true;
 		}
 
-		glm::vec3 GetNextValue(std::vector<Vec3Key> keys) {
-			// default cases
-			if (keys.empty()) {
-				return glm::vec3(0, 0, 0);
+		// loop wraps land on the first or last segment
+		if (time < timeAt(1)) {
+			cursor.index = 0;
+			return 0;
+		}
+		if (time >= timeAt(last)) {
+			cursor.index = last;
+			return last;
+		}
+
+		// seek, find the first key after time
+		int low = 0;
+		int high = count;
+		while (low < high) {
+			int mid = (low + high) / 2;
+			if (timeAt(mid) <= time) {
+				low = mid + 1;
 			}
-			if (keys.size() == 1) {
-				return keys.front().value;
+			else {
+				high = mid;
 			}
+		}
+		cursor.index = std::min(std::max(low - 1, 0), last);
+		return cursor.index;
+	}
 
-			int index = 0;
-			Vec3Key* currentKey = nullptr;
-			Vec3Key* nextKey = nullptr;
-
-			for (index = 0; index < keys.size(); index++) {
-				if (playbackSpeed > 0) {
-					if (playbackTime <= keys[index].time) {
-						nextKey = &keys[index];
-						currentKey = &keys[index - 1];
-						break;
-					}
-				}
-				else if (playbackSpeed < 0) { // handles playing backwards
-					if (playbackTime >= keys[index].time) {
-						nextKey = &keys[index];
-						currentKey = &keys[index + 1];
-						break;
-					}
-				}
-
-			}
+	// Samples a sorted track at time, advancing cursor
+	inline glm::vec3 sampleKeys(const std::vector<Vec3Key>& keys, float time, KeyCursor& cursor) {
+		// default cases
+		if (keys.empty()) {
+			return glm::vec3(0, 0, 0);
+		}
+		if (keys.size() == 1) {
+			return keys.front().value;
+		}
 
-			// return last keyframe value if no new key is found
-			if (nextKey == nullptr) {
-				return keys.back().value;
-			}
+		int index = seekKey(cursor, (int)keys.size(), time, [&keys](int i) { return keys[i].time; });
+		const Vec3Key& currentKey = keys[index];
+		const Vec3Key& nextKey = keys[index + 1];
 
-			// inverse lerp between times
-			float val = (playbackTime - currentKey->time) / (nextKey->time - currentKey->time);
-			// apply easing function
-			val = ease(val, currentKey->easeType);
-			// lerp between values
-			return currentKey->value + (nextKey->value - currentKey->value) * val;
+		// hold the end values outside of the track
+		if (time <= currentKey.time) {
+			return currentKey.value;
+		}
+		if (time >= nextKey.time) {
+			return nextKey.value;
 		}
 
-		void handleUI() {
-
-			if (ImGui::CollapsingHeader("Animation Settings")) {
-				ImGui::Checkbox("Playing", &isPlaying);
-				ImGui::DragFloat("Playback Speed", &playbackSpeed);
-				ImGui::Checkbox("Looping", &isLooping);
-				ImGui::SliderFloat("Playback Time", &playbackTime, 0, clip->duration);
-
-				if (ImGui::CollapsingHeader("Position Keyframes")) {
-					for (int i = 0; i < clip->positionKeys.size(); i++) {
-						ImGui::PushID(i);
-						ImGui::DragFloat("Time", &clip->positionKeys[i].time, 0.1f);
-						ImGui::DragFloat3("Value", &clip->positionKeys[i].value.x, 0.1f);
-						ImGui::Combo("Easing Type", &clip->positionKeys[i].easeType, easingNames, EASING_FUNCTIONS.size());
-						ImGui::PopID();
-					}
-
-					if (ImGui::Button("Sort Keyframes")) {
-						clip->sortKeys(clip->positionKeys, 0, clip->positionKeys.size() - 1);
-					}
-
-					if (ImGui::Button("Add Keyframe")) {
-						clip->positionKeys.push_back(Vec3Key(glm::vec3(0, 0, 0), -1));
-					}
-					if (ImGui::Button("Remove Keyframe")) {
-						if (!clip->positionKeys.empty()) {
-							clip->positionKeys.erase(std::find(clip->positionKeys.begin(), clip->positionKeys.end(), clip->positionKeys.back()));
-						}
-					}
-				}
+		// inverse lerp between times
+		float val = (time - currentKey.time) / (nextKey.time - currentKey.time);
+		// apply easing function
+		val = ease(val, currentKey.easeType);
+		// lerp between values
+		return currentKey.value + (nextKey.value - currentKey.value) * val;
+	}
+#pragma endregion
 
-				if (ImGui::CollapsingHeader("Rotation Keyframes")) {
-					for (int i = 0; i < clip->rotationKeys.size(); i++) {
-						ImGui::PushID(i);
-						ImGui::DragFloat("Time", &clip->rotationKeys[i].time, 0.1f);
-						ImGui::DragFloat3("Value", &clip->rotationKeys[i].value.x, 0.1f);
-						ImGui::Combo("Easing Type", &clip->rotationKeys[i].easeType, easingNames, EASING_FUNCTIONS.size());
-						ImGui::PopID();
-					}
-
-					if (ImGui::Button("Sort Keyframes")) {
-						clip->sortKeys(clip->rotationKeys, 0, clip->rotationKeys.size() - 1);
-					}
-
-					if (ImGui::Button("Add Keyframe")) {
-						clip->rotationKeys.push_back(Vec3Key(glm::vec3(0, 0, 0), -1));
-					}
-					if (ImGui::Button("Remove Keyframe")) {
-						if (!clip->rotationKeys.empty()) {
-							clip->rotationKeys.erase(std::find(clip->rotationKeys.begin(), clip->rotationKeys.end(), clip->rotationKeys.back()));
-						}
-					}
-				}
+	struct AnimationClip {
+		float duration;
+		std::vector<Vec3Key> positionKeys;
+		std::vector<Vec3Key> rotationKeys;
+		std::vector<Vec3Key> scaleKeys;
+		// native rotation track, when empty the rotation keys are converted to quaternions on compile
+		std::vector<QuatKey> orientationKeys;
+
+		AnimationClip() {
+			duration = -1;
+		}
 
-				if (ImGui::CollapsingHeader("Scale Keyframes")) {
-					for (int i = 0; i < clip->scaleKeys.size(); i++) {
-						ImGui::PushID(i);
-						ImGui::DragFloat("Time", &clip->scaleKeys[i].time, 0.1f);
-						ImGui::DragFloat3("Value", &clip->scaleKeys[i].value.x, 0.1f);
-						ImGui::Combo("Easing Type", &clip->scaleKeys[i].easeType, easingNames, EASING_FUNCTIONS.size());
-						ImGui::PopID();
-					}
-
-					if (ImGui::Button("Sort Keyframes")) {
-						clip->sortKeys(clip->scaleKeys, 0, clip->scaleKeys.size() - 1);
-					}
-
-					if (ImGui::Button("Add Keyframe")) {
-						clip->scaleKeys.push_back(Vec3Key(glm::vec3(0, 0, 0), -1));
-					}
-					if (ImGui::Button("Remove Keyframe")) {
-						if (!clip->scaleKeys.empty()) {
-							clip->scaleKeys.erase(std::find(clip->scaleKeys.begin(), clip->scaleKeys.end(), clip->scaleKeys.back()));
-						}
-					}
+		template<typename Key>
+		int partition(std::vector<Key>& keys, int low, int high) {
+			float pivot = keys[high].time;
+			int i = (low - 1);
 
+			for (int j = low; j <= high - 1; j++) {
+				if (keys[j].time <= pivot) {
+					i++;
+					std::swap(keys[i], keys[j]);
 				}
-
 			}
+
+			std::swap(keys[i + 1], keys[high]);
+
+			return (i + 1);
 		}
-	};
 
+		template<typename Key>
+		void sortKeys(std::vector<Key>& keys, int low, int high) {
+			if (low < high) {
+				int pi = partition(keys, low, high);
 
+				sortKeys(keys, low, pi - 1);
+				sortKeys(keys, pi + 1, high);
+			}
+		}
 
-}
\ No newline at end of file
+	};
+}
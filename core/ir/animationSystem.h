@@ -0,0 +1,335 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "compiledClip.h"
+#include "clipLibrary.h"
+#include "fastEasing.h"
+#include "quatTrack.h"
+#include "simd.h"
+
+// Updates and samples many animator instances at once.
+// Instance state lives in parallel arrays so update() and sample() stream
+// through memory and process simd::WIDTH instances per iteration.
+// updateScalar()/sampleScalar() follow Animator exactly and are kept as the
+// reference the SIMD kernels are checked against.
+
+namespace ir {
+	struct AnimationSystem {
+		// per instance state
+		std::vector<ClipHandle> clips; // shared like Animator::clip, so republished clips stay alive while played. Never null.
+		std::vector<float> playbackTimes;
+		std::vector<float> playbackSpeeds; // negatives play backwards
+		std::vector<uint32_t> playingMasks; // simd::MASK_TRUE or simd::MASK_FALSE
+		std::vector<uint32_t> loopingMasks;
+		std::vector<ClipCursor> cursors;
+
+		// sampled values, written by sample()
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> rotations;
+		std::vector<glm::vec3> scales;
+		std::vector<glm::quat> orientations; // from the quaternion track, ready for ew::Transform::rotation
+
+		bool useSimd = true;
+		QuatInterpolation orientationMode = NLERP;
+
+		int size() const {
+			return (int)clips.size();
+		}
+
+		// Returns the index of the new instance, or -1 without adding one if clip is null
+		int addInstance(ClipHandle clip, bool playing = true, bool looping = false, float playbackSpeed = 1) {
+			if (clip == nullptr) {
+				return -1;
+			}
+			clips.push_back(clip);
+			playbackTimes.push_back(0);
+			playbackSpeeds.push_back(playbackSpeed);
+			playingMasks.push_back(playing ? simd::MASK_TRUE : simd::MASK_FALSE);
+			loopingMasks.push_back(looping ? simd::MASK_TRUE : simd::MASK_FALSE);
+			cursors.push_back(ClipCursor());
+			positions.push_back(glm::vec3(0));
+			rotations.push_back(glm::vec3(0));
+			scales.push_back(glm::vec3(1));
+			orientations.push_back(glm::quat(1, 0, 0, 0));
+			return size() - 1;
+		}
+
+		void clear() {
+			clips.clear();
+			playbackTimes.clear();
+			playbackSpeeds.clear();
+			playingMasks.clear();
+			loopingMasks.clear();
+			cursors.clear();
+			positions.clear();
+			rotations.clear();
+			scales.clear();
+			orientations.clear();
+		}
+
+		// Switches an instance to another clip (e.g. after ClipEditor publishes), same rules as Animator::setClip.
+		// Returns false and keeps the current clip if clip is null.
+		bool setClip(int instance, ClipHandle clip) {
+			if (clip == nullptr) {
+				return false;
+			}
+			clips[instance] = clip;
+			cursors[instance].reset();
+			playbackTimes[instance] = std::min(std::max(playbackTimes[instance], 0.0f), std::max(clip->duration(), 0.0f));
+			return true;
+		}
+
+		void setPlaying(int instance, bool playing) {
+			playingMasks[instance] = playing ? simd::MASK_TRUE : simd::MASK_FALSE;
+		}
+
+		void setLooping(int instance, bool looping) {
+			loopingMasks[instance] = looping ? simd::MASK_TRUE : simd::MASK_FALSE;
+		}
+
+		void update(float dt) {
+			if (useSimd) {
+				updateSimd(dt);
+			}
+			else {
+				updateScalar(dt);
+			}
+		}
+
+		void sample() {
+			if (useSimd) {
+				sampleSimd();
+			}
+			else {
+				sampleScalar();
+			}
+		}
+
+#pragma region Scalar
+		// Same rules as Animator::update
+		void updateInstance(int i, float dt) {
+			if (!playingMasks[i]) {
+				return;
+			}
+
+			const float duration = clips[i]->duration();
+			float playbackTime = playbackTimes[i] + playbackSpeeds[i] * dt;
+			if (playbackTime > duration) {
+				if (loopingMasks[i]) {
+					playbackTime = (playbackTime + dt) - duration;
+				}
+				else {
+					playbackTime = duration;
+				}
+			}
+			if (playbackSpeeds[i] < 0 && playbackTime < 0) {
+				if (loopingMasks[i]) {
+					playbackTime = (playbackTime - dt) + duration;
+				}
+				else {
+					playbackTime = 0;
+				}
+			}
+			playbackTimes[i] = playbackTime;
+		}
+
+		void updateScalar(float dt) {
+			for (int i = 0; i < size(); i++) {
+				updateInstance(i, dt);
+			}
+		}
+
+		void sampleScalar() {
+			for (int i = 0; i < size(); i++) {
+				clips[i]->compiled.sample(playbackTimes[i], cursors[i], positions[i], rotations[i], scales[i]);
+				orientations[i] = clips[i]->compiled.sampleOrientation(playbackTimes[i], cursors[i].orientation, orientationMode);
+			}
+		}
+#pragma endregion
+
+#pragma region SIMD
+		void updateSimd(float dt) {
+			using namespace simd;
+			const int count = size();
+			const vfloat delta = set(dt);
+			const vfloat zero = set(0);
+			alignas(32) float durations[WIDTH];
+
+			int i = 0;
+			for (; i + WIDTH <= count; i += WIDTH) {
+				for (int lane = 0; lane < WIDTH; lane++) {
+					durations[lane] = clips[i + lane]->duration();
+				}
+				vfloat oldTime = load(&playbackTimes[i]);
+				vfloat speed = load(&playbackSpeeds[i]);
+				vfloat duration = load(durations);
+				vfloat playing = loadMask(&playingMasks[i]);
+				vfloat looping = loadMask(&loopingMasks[i]);
+
+				vfloat time = add(oldTime, mul(speed, delta));
+
+				vfloat pastEnd = cmpgt(time, duration);
+				vfloat wrappedEnd = select(looping, sub(add(time, delta), duration), duration);
+				time = select(pastEnd, wrappedEnd, time);
+
+				vfloat beforeStart = bitAnd(cmplt(speed, zero), cmplt(time, zero));
+				vfloat wrappedStart = select(looping, add(sub(time, delta), duration), zero);
+				time = select(beforeStart, wrappedStart, time);
+
+				store(&playbackTimes[i], select(playing, time, oldTime));
+			}
+
+			// remainder that does not fill a register
+			for (; i < count; i++) {
+				updateInstance(i, dt);
+			}
+		}
+
+		// Finds each instance's key segment with its cursor, gathers the key pairs
+		// into lanes and interpolates simd::WIDTH instances per track at once
+		void sampleSimd() {
+			using namespace simd;
+			const int count = size();
+			const vfloat zero = set(0);
+			const vfloat one = set(1);
+			const vfloat minSpan = set(1e-30f);
+
+			float time[WIDTH];
+			float t0[WIDTH], t1[WIDTH];
+			float x0[WIDTH], x1[WIDTH];
+			float y0[WIDTH], y1[WIDTH];
+			float z0[WIDTH], z1[WIDTH];
+			int easeTypes[WIDTH];
+			float x[WIDTH], y[WIDTH], z[WIDTH];
+			float w0[WIDTH], w1[WIDTH], w[WIDTH];
+
+			for (int base = 0; base < count; base += WIDTH) {
+				int lanes = std::min(WIDTH, count - base);
+
+				for (int t = 0; t < TRACK_COUNT; t++) {
+					// gather
+					for (int lane = 0; lane < WIDTH; lane++) {
+						if (lane >= lanes) {
+							// pad unused lanes with a constant segment
+							time[lane] = t0[lane] = 0;
+							t1[lane] = 1;
+							x0[lane] = x1[lane] = y0[lane] = y1[lane] = z0[lane] = z1[lane] = 0;
+							easeTypes[lane] = NONE;
+							continue;
+						}
+						int i = base + lane;
+						const TrackView& track = clips[i]->compiled.tracks[t];
+						time[lane] = playbackTimes[i];
+						easeTypes[lane] = NONE;
+						if (track.count == 0) {
+							t0[lane] = 0;
+							t1[lane] = 1;
+							x0[lane] = x1[lane] = y0[lane] = y1[lane] = z0[lane] = z1[lane] = 0;
+							continue;
+						}
+						if (track.count == 1) {
+							t0[lane] = 0;
+							t1[lane] = 1;
+							x0[lane] = x1[lane] = track.x[0];
+							y0[lane] = y1[lane] = track.y[0];
+							z0[lane] = z1[lane] = track.z[0];
+							continue;
+						}
+						const float* times = track.times;
+						int k = seekKey(cursors[i].tracks[t], track.count, time[lane], [times](int key) { return times[key]; });
+						t0[lane] = times[k];
+						t1[lane] = times[k + 1];
+						x0[lane] = track.x[k];
+						x1[lane] = track.x[k + 1];
+						y0[lane] = track.y[k];
+						y1[lane] = track.y[k + 1];
+						z0[lane] = track.z[k];
+						z1[lane] = track.z[k + 1];
+						easeTypes[lane] = track.easeTypes[k];
+					}
+
+					// inverse lerp between times, holding the end values outside the segment
+					vfloat start = load(t0);
+					vfloat span = max(sub(load(t1), start), minSpan);
+					vfloat a = clamp(div(sub(load(time), start), span), zero, one);
+
+					a = easeLanes(a, easeTypes);
+
+					store(x, lerp(load(x0), load(x1), a));
+					store(y, lerp(load(y0), load(y1), a));
+					store(z, lerp(load(z0), load(z1), a));
+
+					// scatter
+					std::vector<glm::vec3>& out = (t == TRACK_POSITION) ? positions : (t == TRACK_ROTATION) ? rotations : scales;
+					for (int lane = 0; lane < lanes; lane++) {
+						out[base + lane] = glm::vec3(x[lane], y[lane], z[lane]);
+					}
+				}
+
+				// orientation, same steps with quaternion key pairs
+				for (int lane = 0; lane < WIDTH; lane++) {
+					time[lane] = t0[lane] = 0;
+					t1[lane] = 1;
+					x0[lane] = x1[lane] = y0[lane] = y1[lane] = z0[lane] = z1[lane] = 0;
+					w0[lane] = w1[lane] = 1;
+					easeTypes[lane] = NONE;
+					if (lane >= lanes) {
+						continue;
+					}
+					int i = base + lane;
+					const QuatTrackView& track = clips[i]->compiled.orientation;
+					time[lane] = playbackTimes[i];
+					if (track.count == 0) {
+						continue;
+					}
+					int k = 0;
+					if (track.count > 1) {
+						const float* times = track.times;
+						k = seekKey(cursors[i].orientation, track.count, time[lane], [times](int key) { return times[key]; });
+						t0[lane] = times[k];
+						t1[lane] = times[k + 1];
+					}
+					int next = std::min(k + 1, track.count - 1);
+					x0[lane] = track.x[k];
+					x1[lane] = track.x[next];
+					y0[lane] = track.y[k];
+					y1[lane] = track.y[next];
+					z0[lane] = track.z[k];
+					z1[lane] = track.z[next];
+					w0[lane] = track.w[k];
+					w1[lane] = track.w[next];
+					easeTypes[lane] = track.easeTypes[k];
+				}
+
+				vfloat start = load(t0);
+				vfloat span = max(sub(load(t1), start), minSpan);
+				vfloat a = easeLanes(clamp(div(sub(load(time), start), span), zero, one), easeTypes);
+				QuatLanes q0 = loadQuatLanes(x0, y0, z0, w0);
+				QuatLanes q1 = loadQuatLanes(x1, y1, z1, w1);
+				storeQuatLanes(interpolateN(q0, q1, a, orientationMode), x, y, z, w);
+				for (int lane = 0; lane < lanes; lane++) {
+					orientations[base + lane] = glm::quat(w[lane], x[lane], y[lane], z[lane]);
+				}
+			}
+		}
+
+		// Easing only applies strictly inside a segment, runs each easing kernel present in easeTypes
+		static simd::vfloat easeLanes(simd::vfloat a, const int* easeTypes) {
+			using namespace simd;
+			uint32_t typeMasks[WIDTH];
+			vfloat inside = bitAnd(cmpgt(a, set(0)), cmplt(a, set(1)));
+			for (int type = NONE + 1; type < (int)EASING_FUNCTIONS.size(); type++) {
+				bool present = false;
+				for (int lane = 0; lane < WIDTH; lane++) {
+					typeMasks[lane] = (easeTypes[lane] == type) ? MASK_TRUE : MASK_FALSE;
+					present |= easeTypes[lane] == type;
+				}
+				if (present) {
+					a = select(bitAnd(loadMask(typeMasks), inside), easeFastN(a, type), a);
+				}
+			}
+			return a;
+		}
+#pragma endregion
+	};
+}
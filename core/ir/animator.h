@@ -0,0 +1,163 @@
+#pragma once
+#include "animation.h"
+#include "compiledClip.h"
+#include "clipLibrary.h"
+
+namespace ir {
+	// Playback state for one instance of a shared clip.
+	// The clip itself lives in a ClipResource, so animators are small, cheap to copy
+	// and any number of them can play the same clip. Use ClipEditor to change keys.
+	struct Animator {
+		ClipHandle clip; // shared, never modified through the animator
+		bool isPlaying;
+		float playbackSpeed; // negatives play backwards
+		bool isLooping; // if false, stop once the clip's duration is reached
+		float playbackTime; // current time, between 0 and the clip's duration
+		int orientationMode; // QuatInterpolation used by sampleOrientation
+		ClipCursor cursor;
+		KeyCursor scratchCursor; // tracks that are not part of clip
+
+		Animator() {
+			isPlaying = false;
+			playbackSpeed = 1;
+			isLooping = false;
+			playbackTime = 0;
+			orientationMode = NLERP;
+		}
+
+		Animator(ClipHandle theClip) : Animator() {
+			clip = theClip;
+		}
+
+		// Switches clips, keeping the playback time inside the new clip
+		void setClip(ClipHandle theClip) {
+			clip = theClip;
+			cursor.reset();
+			if (clip != nullptr) {
+				playbackTime = std::min(std::max(playbackTime, 0.0f), std::max(clip->duration(), 0.0f));
+			}
+		}
+
+		bool update(float dt) {
+			if (!isPlaying || clip == nullptr) {
+				return false;
+			}
+
+			const float duration = clip->duration();
+			playbackTime += playbackSpeed * dt;
+
+			if (playbackTime > duration) {
+				if (isLooping) {
+					playbackTime = (playbackTime + dt) - duration;
+				}
+				else {
+					playbackTime = duration;
+				}
+			}
+			if (playbackSpeed < 0 && playbackTime < 0) {
+				if (isLooping) {
+					playbackTime = (playbackTime - dt) + duration;
+				}
+				else {
+					playbackTime = 0;
+				}
+			}
+			return true;
+		}
+
+		// Samples position, rotation and scale in one pass, from the baked, compressed or compiled clip
+		void sample(glm::vec3& position, glm::vec3& rotation, glm::vec3& scale) {
+			if (clip == nullptr) {
+				return;
+			}
+			if (clip->bakeRate > 0) {
+				clip->baked.sample(playbackTime, position, rotation, scale);
+				return;
+			}
+			if (clip->compressTolerance > 0) {
+				clip->compressed.sample(playbackTime, cursor, position, rotation, scale);
+				return;
+			}
+			clip->compiled.sample(playbackTime, cursor, position, rotation, scale);
+		}
+
+		// Same, with the rotation from the quaternion track so it can go straight into ew::Transform::rotation.
+		// Baking and compression only cover the Euler tracks, so the orientation always comes from the compiled clip.
+		void sample(glm::vec3& position, glm::quat& rotation, glm::vec3& scale) {
+			if (clip == nullptr) {
+				return;
+			}
+			if (clip->bakeRate > 0) {
+				clip->baked.sample(playbackTime, position, scale);
+				rotation = sampleOrientation();
+				return;
+			}
+			if (clip->compressTolerance > 0) {
+				position = clip->compressed.sample(TRACK_POSITION, playbackTime, cursor.tracks[TRACK_POSITION]);
+				scale = clip->compressed.sample(TRACK_SCALE, playbackTime, cursor.tracks[TRACK_SCALE]);
+				rotation = sampleOrientation();
+				return;
+			}
+			clip->compiled.sample(playbackTime, cursor, (QuatInterpolation)orientationMode, position, rotation, scale);
+		}
+
+		glm::vec3 sampleTrack(ClipTrack track) {
+			if (clip == nullptr) {
+				return glm::vec3(0, 0, 0);
+			}
+			if (clip->bakeRate > 0) {
+				return clip->baked.sample(track, playbackTime);
+			}
+			if (clip->compressTolerance > 0) {
+				return clip->compressed.sample(track, playbackTime, cursor.tracks[track]);
+			}
+			return clip->compiled.sample(track, playbackTime, cursor.tracks[track]);
+		}
+
+		glm::vec3 samplePosition() {
+			return sampleTrack(TRACK_POSITION);
+		}
+
+		glm::vec3 sampleRotation() {
+			return sampleTrack(TRACK_ROTATION);
+		}
+
+		glm::vec3 sampleScale() {
+			return sampleTrack(TRACK_SCALE);
+		}
+
+		glm::quat sampleOrientation() {
+			if (clip == nullptr) {
+				return glm::quat(1, 0, 0, 0);
+			}
+			return clip->compiled.sampleOrientation(playbackTime, cursor.orientation, (QuatInterpolation)orientationMode);
+		}
+
+		// Clip tracks are sampled from the compiled clip, other tracks directly
+		glm::vec3 GetNextValue(const std::vector<Vec3Key>& keys) {
+			if (clip != nullptr) {
+				if (&keys == &clip->source.positionKeys) {
+					return samplePosition();
+				}
+				if (&keys == &clip->source.rotationKeys) {
+					return sampleRotation();
+				}
+				if (&keys == &clip->source.scaleKeys) {
+					return sampleScale();
+				}
+			}
+			return sampleKeys(keys, playbackTime, scratchCursor);
+		}
+
+		void handleUI() {
+
+			if (ImGui::CollapsingHeader("Animation Settings")) {
+				ImGui::Checkbox("Playing", &isPlaying);
+				ImGui::DragFloat("Playback Speed", &playbackSpeed);
+				ImGui::Checkbox("Looping", &isLooping);
+				ImGui::SliderFloat("Playback Time", &playbackTime, 0, clip != nullptr ? clip->duration() : 0);
+				ImGui::Combo("Orientation Interpolation", &orientationMode, quatInterpolationNames, 2);
+			}
+		}
+	};
+}
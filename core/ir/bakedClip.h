@@ -0,0 +1,126 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+#include "compiledClip.h"
+
+// Clip resampled at a fixed rate with easing already applied.
+// Sampling is index arithmetic plus one lerp, no key search and no easing call.
+// Baking trades memory for accuracy, BakeReport estimates how much was lost.
+
+namespace ir {
+	const int BAKE_ERROR_SUBSAMPLES = 8; // source samples compared per baked interval
+	const float MIN_BAKE_RATE = 1; // samples per second
+
+	struct BakeReport {
+		int sampleCount = 0;
+		size_t bytes = 0;
+		// Largest distance from the source curve per track, over BAKE_ERROR_SUBSAMPLES - 1 points
+		// inside each baked interval. A sampled estimate, not a bound: a curve that swings
+		// between those points (elastic easing, short keys) can be off by more.
+		float sampledMaxError[TRACK_COUNT] = { 0, 0, 0 };
+	};
+
+	struct BakedClip {
+		float duration = 0;
+		float sampleRate = 0; // samples per second
+		int sampleCount = 0;
+		std::vector<glm::vec3> samples; // frame major, TRACK_COUNT values per frame
+
+		void bake(const AnimationClip& clip, float rate, BakeReport* report = nullptr) {
+			bake(CompiledClip(clip), rate, report);
+		}
+
+		void bake(const CompiledClip& source, float rate, BakeReport* report = nullptr) {
+			duration = std::max(source.duration, 0.0f);
+			sampleRate = std::max(rate, MIN_BAKE_RATE);
+			sampleCount = (int)std::ceil(duration * sampleRate) + 1;
+			samples.resize((size_t)sampleCount * TRACK_COUNT);
+
+			ClipCursor cursor;
+			for (int frame = 0; frame < sampleCount; frame++) {
+				glm::vec3* values = &samples[(size_t)frame * TRACK_COUNT];
+				source.sample(frameTime(frame), cursor, values[TRACK_POSITION], values[TRACK_ROTATION], values[TRACK_SCALE]);
+			}
+
+			if (report == nullptr) {
+				return;
+			}
+
+			// compare against the source curve between every pair of samples
+			*report = BakeReport();
+			report->sampleCount = sampleCount;
+			report->bytes = samples.size() * sizeof(glm::vec3);
+			cursor.reset();
+			for (int frame = 0; frame + 1 < sampleCount; frame++) {
+				float start = frameTime(frame);
+				float end = frameTime(frame + 1);
+				for (int s = 1; s < BAKE_ERROR_SUBSAMPLES; s++) {
+					float time = start + (end - start) * s / BAKE_ERROR_SUBSAMPLES;
+					glm::vec3 expected[TRACK_COUNT];
+					source.sample(time, cursor, expected[TRACK_POSITION], expected[TRACK_ROTATION], expected[TRACK_SCALE]);
+					for (int t = 0; t < TRACK_COUNT; t++) {
+						report->sampledMaxError[t] = std::max(report->sampledMaxError[t], glm::length(sample((ClipTrack)t, time) - expected[t]));
+					}
+				}
+			}
+		}
+
+		float frameTime(int frame) const {
+			return std::min(frame / sampleRate, duration);
+		}
+
+		// Frame before time and how far time is towards the next frame
+		int locate(float time, float& alpha) const {
+			if (sampleCount < 2) {
+				alpha = 0;
+				return 0;
+			}
+			float position = std::min(std::max(time, 0.0f), duration) * sampleRate;
+			int frame = std::min((int)position, sampleCount - 2);
+			// the last interval can be shorter than the others
+			float span = (frameTime(frame + 1) - frameTime(frame)) * sampleRate;
+			alpha = span > 0 ? std::min((position - frame) / span, 1.0f) : 0;
+			return frame;
+		}
+
+		glm::vec3 sample(ClipTrack track, float time) const {
+			if (sampleCount == 0) {
+				return glm::vec3(0);
+			}
+			float alpha;
+			int frame = locate(time, alpha);
+			const glm::vec3& a = samples[(size_t)frame * TRACK_COUNT + track];
+			const glm::vec3& b = samples[(size_t)std::min(frame + 1, sampleCount - 1) * TRACK_COUNT + track];
+			return a + (b - a) * alpha;
+		}
+
+		void sample(float time, glm::vec3& position, glm::vec3& rotation, glm::vec3& scale) const {
+			if (sampleCount == 0) {
+				position = rotation = scale = glm::vec3(0);
+				return;
+			}
+			float alpha;
+			int frame = locate(time, alpha);
+			const glm::vec3* a = &samples[(size_t)frame * TRACK_COUNT];
+			const glm::vec3* b = &samples[(size_t)std::min(frame + 1, sampleCount - 1) * TRACK_COUNT];
+			position = a[TRACK_POSITION] + (b[TRACK_POSITION] - a[TRACK_POSITION]) * alpha;
+			rotation = a[TRACK_ROTATION] + (b[TRACK_ROTATION] - a[TRACK_ROTATION]) * alpha;
+			scale = a[TRACK_SCALE] + (b[TRACK_SCALE] - a[TRACK_SCALE]) * alpha;
+		}
+
+		// Position and scale only, for callers that take the rotation from the quaternion track
+		void sample(float time, glm::vec3& position, glm::vec3& scale) const {
+			if (sampleCount == 0) {
+				position = scale = glm::vec3(0);
+				return;
+			}
+			float alpha;
+			int frame = locate(time, alpha);
+			const glm::vec3* a = &samples[(size_t)frame * TRACK_COUNT];
+			const glm::vec3* b = &samples[(size_t)std::min(frame + 1, sampleCount - 1) * TRACK_COUNT];
+			position = a[TRACK_POSITION] + (b[TRACK_POSITION] - a[TRACK_POSITION]) * alpha;
+			scale = a[TRACK_SCALE] + (b[TRACK_SCALE] - a[TRACK_SCALE]) * alpha;
+		}
+	};
+}
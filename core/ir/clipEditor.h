@@ -0,0 +1,192 @@
+#pragma once
+#include <string>
+#include "animation.h"
+#include "clipLibrary.h"
+#include "clipFile.h"
+
+namespace ir {
+	// Keyframe editor for one clip.
+	// Edits go to a private working copy; publishing builds a new immutable clip
+	// and replaces the library entry (copy on write), so shared clips are never modified in place.
+	struct ClipEditor {
+		AnimationClip clip; // working copy
+		std::string name; // library entry this editor publishes to
+		ClipLibrary* library;
+		float bakeRate; // samples per second, 0 plays the compiled keys directly
+		float compressTolerance; // 0 keeps every key, only used when not baked
+		char clipFilePath[256] = "assets/clip.irclip"; // used by the Save/Load Clip buttons
+		ClipHandle published; // last clip built from the working copy
+
+		ClipEditor() {
+			library = nullptr;
+			bakeRate = 0;
+			compressTolerance = 0;
+		}
+
+		ClipEditor(ClipLibrary* theLibrary, const std::string& theName) {
+			library = theLibrary;
+			name = theName;
+			bakeRate = 0;
+			compressTolerance = 0;
+		}
+
+		// Reads clipFilePath into the working copy, returns false if there is no valid clip file
+		bool load() {
+			return loadClip(clipFilePath, clip);
+		}
+
+		// Builds a clip from the working copy and hands it to the library
+		ClipHandle publish() {
+			published = (library != nullptr) ? library->add(name, clip, bakeRate, compressTolerance) : makeClip(clip, bakeRate, compressTolerance);
+			return published;
+		}
+
+		// Publishes any edits made this frame, returns true if there is a new clip
+		bool handleUI() {
+			bool changed = false;
+
+			if (ImGui::CollapsingHeader("Clip Editor")) {
+				ImGui::InputText("Clip File", clipFilePath, sizeof(clipFilePath));
+				if (ImGui::Button("Save Clip")) {
+					saveClip(clip, clipFilePath);
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Load Clip")) {
+					changed |= load();
+				}
+				changed |= ImGui::DragFloat("Bake Rate", &bakeRate, 1.0f, 0.0f, 240.0f);
+				if (published != nullptr && published->bakeRate > 0) {
+					const BakeReport& bakeReport = published->bakeReport;
+					ImGui::Text("Baked %d samples, %d bytes", bakeReport.sampleCount, (int)bakeReport.bytes);
+					ImGui::Text("Sampled max error P %.4f R %.4f S %.4f", bakeReport.sampledMaxError[TRACK_POSITION], bakeReport.sampledMaxError[TRACK_ROTATION], bakeReport.sampledMaxError[TRACK_SCALE]);
+				}
+				changed |= ImGui::DragFloat("Compress Tolerance", &compressTolerance, 0.001f, 0.0f, 1.0f);
+				if (published != nullptr && published->compressTolerance > 0) {
+					const CompressionReport& compressionReport = published->compressionReport;
+					ImGui::Text("Compressed %d bytes to %d", (int)compressionReport.bytesBefore, (int)compressionReport.bytesAfter);
+					ImGui::Text("Sampled max error P %.4f R %.4f S %.4f", compressionReport.sampledMaxError[TRACK_POSITION], compressionReport.sampledMaxError[TRACK_ROTATION], compressionReport.sampledMaxError[TRACK_SCALE]);
+				}
+
+				if (ImGui::CollapsingHeader("Position Keyframes")) {
+					for (int i = 0; i < clip.positionKeys.size(); i++) {
+						ImGui::PushID(i);
+						changed |= ImGui::DragFloat("Time", &clip.positionKeys[i].time, 0.1f);
+						changed |= ImGui::DragFloat3("Value", &clip.positionKeys[i].value.x, 0.1f);
+						changed |= ImGui::Combo("Easing Type", &clip.positionKeys[i].easeType, easingNames, EASING_FUNCTIONS.size());
+						ImGui::PopID();
+					}
+
+					if (ImGui::Button("Sort Keyframes")) {
+						clip.sortKeys(clip.positionKeys, 0, clip.positionKeys.size() - 1);
+						changed = true;
+					}
+
+					if (ImGui::Button("Add Keyframe")) {
+						clip.positionKeys.push_back(Vec3Key(glm::vec3(0, 0, 0), -1));
+						changed = true;
+					}
+					if (ImGui::Button("Remove Keyframe")) {
+						if (!clip.positionKeys.empty()) {
+							clip.positionKeys.erase(std::find(clip.positionKeys.begin(), clip.positionKeys.end(), clip.positionKeys.back()));
+							changed = true;
+						}
+					}
+				}
+
+				if (ImGui::CollapsingHeader("Rotation Keyframes")) {
+					for (int i = 0; i < clip.rotationKeys.size(); i++) {
+						ImGui::PushID(i);
+						changed |= ImGui::DragFloat("Time", &clip.rotationKeys[i].time, 0.1f);
+						changed |= ImGui::DragFloat3("Value", &clip.rotationKeys[i].value.x, 0.1f);
+						changed |= ImGui::Combo("Easing Type", &clip.rotationKeys[i].easeType, easingNames, EASING_FUNCTIONS.size());
+						ImGui::PopID();
+					}
+
+					if (ImGui::Button("Sort Keyframes")) {
+						clip.sortKeys(clip.rotationKeys, 0, clip.rotationKeys.size() - 1);
+						changed = true;
+					}
+
+					if (ImGui::Button("Add Keyframe")) {
+						clip.rotationKeys.push_back(Vec3Key(glm::vec3(0, 0, 0), -1));
+						changed = true;
+					}
+					if (ImGui::Button("Remove Keyframe")) {
+						if (!clip.rotationKeys.empty()) {
+							clip.rotationKeys.erase(std::find(clip.rotationKeys.begin(), clip.rotationKeys.end(), clip.rotationKeys.back()));
+							changed = true;
+						}
+					}
+				}
+
+				if (ImGui::CollapsingHeader("Orientation Keyframes")) {
+					for (int i = 0; i < clip.orientationKeys.size(); i++) {
+						ImGui::PushID(i);
+						changed |= ImGui::DragFloat("Time", &clip.orientationKeys[i].time, 0.1f);
+						changed |= ImGui::DragFloat4("Value", &clip.orientationKeys[i].value.x, 0.01f);
+						changed |= ImGui::Combo("Easing Type", &clip.orientationKeys[i].easeType, easingNames, EASING_FUNCTIONS.size());
+						ImGui::PopID();
+					}
+
+					if (ImGui::Button("Sort Keyframes")) {
+						clip.sortKeys(clip.orientationKeys, 0, clip.orientationKeys.size() - 1);
+						changed = true;
+					}
+
+					if (ImGui::Button("Add Keyframe")) {
+						clip.orientationKeys.push_back(QuatKey(glm::quat(1, 0, 0, 0), -1));
+						changed = true;
+					}
+					if (ImGui::Button("Remove Keyframe")) {
+						if (!clip.orientationKeys.empty()) {
+							clip.orientationKeys.erase(std::find(clip.orientationKeys.begin(), clip.orientationKeys.end(), clip.orientationKeys.back()));
+							changed = true;
+						}
+					}
+					// replaces the orientation track with the Euler rotation keys, converted once
+					if (ImGui::Button("Convert Rotation Keyframes")) {
+						clip.orientationKeys.clear();
+						for (const Vec3Key& key : clip.rotationKeys) {
+							QuatKey quatKey(glm::quat(key.value), key.time);
+							quatKey.easeType = key.easeType;
+							clip.orientationKeys.push_back(quatKey);
+						}
+						changed = true;
+					}
+				}
+
+				if (ImGui::CollapsingHeader("Scale Keyframes")) {
+					for (int i = 0; i < clip.scaleKeys.size(); i++) {
+						ImGui::PushID(i);
+						changed |= ImGui::DragFloat("Time", &clip.scaleKeys[i].time, 0.1f);
+						changed |= ImGui::DragFloat3("Value", &clip.scaleKeys[i].value.x, 0.1f);
+						changed |= ImGui::Combo("Easing Type", &clip.scaleKeys[i].easeType, easingNames, EASING_FUNCTIONS.size());
+						ImGui::PopID();
+					}
+
+					if (ImGui::Button("Sort Keyframes")) {
+						clip.sortKeys(clip.scaleKeys, 0, clip.scaleKeys.size() - 1);
+						changed = true;
+					}
+
+					if (ImGui::Button("Add Keyframe")) {
+						clip.scaleKeys.push_back(Vec3Key(glm::vec3(0, 0, 0), -1));
+						changed = true;
+					}
+					if (ImGui::Button("Remove Keyframe")) {
+						if (!clip.scaleKeys.empty()) {
+							clip.scaleKeys.erase(std::find(clip.scaleKeys.begin(), clip.scaleKeys.end(), clip.scaleKeys.back()));
+							changed = true;
+						}
+					}
+
+				}
+			}
+
+			if (changed) {
+				publish();
+			}
+			return changed;
+		}
+	};
+}
@@ -0,0 +1,271 @@
+#include "clipFile.h"
+#include <stdio.h>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ir {
+	static uint32_t alignOffset(size_t offset) {
+		return (uint32_t)((offset + CLIP_LANE_ALIGNMENT - 1) / CLIP_LANE_ALIGNMENT * CLIP_LANE_ALIGNMENT);
+	}
+
+	// Easing types must index EASING_FUNCTIONS and times must not decrease, seekKey relies on it
+	static bool validKeys(const char* data, uint32_t count, uint32_t timesOffset, uint32_t easeOffset) {
+		const float* times = (const float*)(data + timesOffset);
+		const uint8_t* easeTypes = (const uint8_t*)(data + easeOffset);
+		for (uint32_t k = 0; k < count; k++) {
+			if (easeTypes[k] >= EASING_FUNCTIONS.size()) {
+				return false;
+			}
+			// also rejects NaN times
+			if (k > 0 && !(times[k] >= times[k - 1])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool saveClip(const AnimationClip& clip, const char* filePath) {
+		return saveClip(CompiledClip(clip), filePath);
+	}
+
+	bool saveClip(const CompiledClip& clip, const char* filePath) {
+		ClipFileHeader header = {};
+		memcpy(header.magic, CLIP_FILE_MAGIC, sizeof(header.magic));
+		header.version = CLIP_FILE_VERSION;
+		header.duration = clip.duration;
+		header.trackCount = TRACK_COUNT;
+
+		// lay out every lane on an aligned offset, like CompiledClip does in memory
+		size_t size = sizeof(ClipFileHeader);
+		for (int t = 0; t < TRACK_COUNT; t++) {
+			ClipFileTrack& track = header.tracks[t];
+			uint32_t laneBytes = clip.tracks[t].count * sizeof(float);
+			track.count = clip.tracks[t].count;
+			track.timesOffset = alignOffset(size);
+			track.xOffset = alignOffset(track.timesOffset + laneBytes);
+			track.yOffset = alignOffset(track.xOffset + laneBytes);
+			track.zOffset = alignOffset(track.yOffset + laneBytes);
+			track.easeOffset = track.zOffset + laneBytes;
+			size = track.easeOffset + track.count;
+		}
+		ClipFileQuatTrack& orientation = header.orientation;
+		uint32_t quatLaneBytes = clip.orientation.count * sizeof(float);
+		orientation.count = clip.orientation.count;
+		orientation.timesOffset = alignOffset(size);
+		orientation.xOffset = alignOffset(orientation.timesOffset + quatLaneBytes);
+		orientation.yOffset = alignOffset(orientation.xOffset + quatLaneBytes);
+		orientation.zOffset = alignOffset(orientation.yOffset + quatLaneBytes);
+		orientation.wOffset = alignOffset(orientation.zOffset + quatLaneBytes);
+		orientation.easeOffset = orientation.wOffset + quatLaneBytes;
+		size = orientation.easeOffset + orientation.count;
+		header.eulerOrientation = clip.eulerOrientation ? 1 : 0;
+
+		std::vector<char> bytes(size, 0);
+		memcpy(bytes.data(), &header, sizeof(header));
+		for (int t = 0; t < TRACK_COUNT; t++) {
+			const ClipFileTrack& track = header.tracks[t];
+			const TrackView& view = clip.tracks[t];
+			if (view.count == 0) {
+				continue;
+			}
+			size_t laneBytes = view.count * sizeof(float);
+			memcpy(&bytes[track.timesOffset], view.times, laneBytes);
+			memcpy(&bytes[track.xOffset], view.x, laneBytes);
+			memcpy(&bytes[track.yOffset], view.y, laneBytes);
+			memcpy(&bytes[track.zOffset], view.z, laneBytes);
+			memcpy(&bytes[track.easeOffset], view.easeTypes, view.count);
+		}
+		if (clip.orientation.count > 0) {
+			memcpy(&bytes[orientation.timesOffset], clip.orientation.times, quatLaneBytes);
+			memcpy(&bytes[orientation.xOffset], clip.orientation.x, quatLaneBytes);
+			memcpy(&bytes[orientation.yOffset], clip.orientation.y, quatLaneBytes);
+			memcpy(&bytes[orientation.zOffset], clip.orientation.z, quatLaneBytes);
+			memcpy(&bytes[orientation.wOffset], clip.orientation.w, quatLaneBytes);
+			memcpy(&bytes[orientation.easeOffset], clip.orientation.easeTypes, clip.orientation.count);
+		}
+
+		FILE* file = fopen(filePath, "wb");
+		if (file == NULL) {
+			printf("Failed to open clip file %s for writing\n", filePath);
+			return false;
+		}
+		bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+		fclose(file);
+		if (!written) {
+			printf("Failed to write clip file %s\n", filePath);
+		}
+		return written;
+	}
+
+	bool loadClip(const char* filePath, AnimationClip& clip) {
+		MappedClip mapped;
+		if (!mapped.open(filePath)) {
+			return false;
+		}
+		clip.duration = mapped.getDuration();
+		std::vector<Vec3Key>* tracks[TRACK_COUNT] = { &clip.positionKeys, &clip.rotationKeys, &clip.scaleKeys };
+		for (int t = 0; t < TRACK_COUNT; t++) {
+			const TrackView& view = mapped.getTracks()[t];
+			tracks[t]->clear();
+			for (int k = 0; k < view.count; k++) {
+				Vec3Key key(glm::vec3(view.x[k], view.y[k], view.z[k]), view.times[k]);
+				key.easeType = view.easeTypes[k];
+				tracks[t]->push_back(key);
+			}
+		}
+		// converted orientations are rebuilt from the rotation keys on compile
+		clip.orientationKeys.clear();
+		if (!mapped.isEulerOrientation()) {
+			const QuatTrackView& view = mapped.getOrientation();
+			for (int k = 0; k < view.count; k++) {
+				QuatKey key(glm::quat(view.w[k], view.x[k], view.y[k], view.z[k]), view.times[k]);
+				key.easeType = view.easeTypes[k];
+				clip.orientationKeys.push_back(key);
+			}
+		}
+		return true;
+	}
+
+	MappedClip::MappedClip(const char* filePath)
+	{
+		open(filePath);
+	}
+
+	MappedClip::~MappedClip()
+	{
+		close();
+	}
+
+	bool MappedClip::open(const char* filePath)
+	{
+		close();
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			printf("Failed to open clip file %s\n", filePath);
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(file, &fileSize);
+		HANDLE mapping = fileSize.QuadPart > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+		const void* view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (view == NULL) {
+			printf("Failed to map clip file %s\n", filePath);
+			if (mapping != NULL) {
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			return false;
+		}
+		m_fileHandle = file;
+		m_mappingHandle = mapping;
+		m_data = (const char*)view;
+		m_size = (size_t)fileSize.QuadPart;
+#else
+		int file = ::open(filePath, O_RDONLY);
+		if (file < 0) {
+			printf("Failed to open clip file %s\n", filePath);
+			return false;
+		}
+		struct stat fileStat;
+		void* view = MAP_FAILED;
+		if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0) {
+			view = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		}
+		::close(file); // the mapping stays valid without the descriptor
+		if (view == MAP_FAILED) {
+			printf("Failed to map clip file %s\n", filePath);
+			return false;
+		}
+		m_data = (const char*)view;
+		m_size = (size_t)fileStat.st_size;
+#endif
+
+		// validate before handing out any pointers into the mapping
+		const ClipFileHeader* header = (const ClipFileHeader*)m_data;
+		bool valid = m_size >= sizeof(ClipFileHeader)
+			&& memcmp(header->magic, CLIP_FILE_MAGIC, sizeof(header->magic)) == 0
+			&& header->version == CLIP_FILE_VERSION
+			&& header->trackCount == TRACK_COUNT;
+		for (int t = 0; valid && t < TRACK_COUNT; t++) {
+			const ClipFileTrack& track = header->tracks[t];
+			size_t laneBytes = (size_t)track.count * sizeof(float);
+			uint32_t laneOffsets[4] = { track.timesOffset, track.xOffset, track.yOffset, track.zOffset };
+			for (int lane = 0; lane < 4; lane++) {
+				valid &= laneOffsets[lane] % sizeof(float) == 0 && laneOffsets[lane] + laneBytes <= m_size;
+			}
+			valid &= (size_t)track.easeOffset + track.count <= m_size;
+			valid = valid && validKeys(m_data, track.count, track.timesOffset, track.easeOffset);
+		}
+		if (valid) {
+			const ClipFileQuatTrack& track = header->orientation;
+			size_t laneBytes = (size_t)track.count * sizeof(float);
+			uint32_t laneOffsets[5] = { track.timesOffset, track.xOffset, track.yOffset, track.zOffset, track.wOffset };
+			for (int lane = 0; lane < 5; lane++) {
+				valid &= laneOffsets[lane] % sizeof(float) == 0 && laneOffsets[lane] + laneBytes <= m_size;
+			}
+			valid &= (size_t)track.easeOffset + track.count <= m_size;
+			valid = valid && validKeys(m_data, track.count, track.timesOffset, track.easeOffset);
+		}
+		if (!valid) {
+			printf("%s is not a valid version %u clip file\n", filePath, CLIP_FILE_VERSION);
+			close();
+			return false;
+		}
+
+		m_duration = header->duration;
+		for (int t = 0; t < TRACK_COUNT; t++) {
+			const ClipFileTrack& track = header->tracks[t];
+			m_tracks[t].count = (int)track.count;
+			m_tracks[t].times = (const float*)(m_data + track.timesOffset);
+			m_tracks[t].x = (const float*)(m_data + track.xOffset);
+			m_tracks[t].y = (const float*)(m_data + track.yOffset);
+			m_tracks[t].z = (const float*)(m_data + track.zOffset);
+			m_tracks[t].easeTypes = (const uint8_t*)(m_data + track.easeOffset);
+		}
+		const ClipFileQuatTrack& orientation = header->orientation;
+		m_orientation.count = (int)orientation.count;
+		m_orientation.times = (const float*)(m_data + orientation.timesOffset);
+		m_orientation.x = (const float*)(m_data + orientation.xOffset);
+		m_orientation.y = (const float*)(m_data + orientation.yOffset);
+		m_orientation.z = (const float*)(m_data + orientation.zOffset);
+		m_orientation.w = (const float*)(m_data + orientation.wOffset);
+		m_orientation.easeTypes = (const uint8_t*)(m_data + orientation.easeOffset);
+		m_eulerOrientation = header->eulerOrientation != 0;
+		return true;
+	}
+
+	void MappedClip::close()
+	{
+		if (m_data != nullptr) {
+#ifdef _WIN32
+			UnmapViewOfFile(m_data);
+			CloseHandle((HANDLE)m_mappingHandle);
+			CloseHandle((HANDLE)m_fileHandle);
+#else
+			munmap((void*)m_data, m_size);
+#endif
+		}
+		m_data = nullptr;
+		m_size = 0;
+		m_fileHandle = nullptr;
+		m_mappingHandle = nullptr;
+		m_duration = -1;
+		for (int t = 0; t < TRACK_COUNT; t++) {
+			m_tracks[t] = TrackView();
+		}
+		m_orientation = QuatTrackView();
+		m_eulerOrientation = false;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include "compiledClip.h"
+
+// Versioned binary clip format (.irclip).
+// The file is a CompiledClip written to disk: a header followed by aligned
+// time/x/y/z lanes and easing bytes per track, then the quaternion rotation track
+// with an extra w lane. A MappedClip maps the file and
+// samples straight from the mapped pages, so loading does no parsing or allocation
+// beyond one validation pass over the key times and easing bytes.
+// All values are little endian.
+
+namespace ir {
+	const char CLIP_FILE_MAGIC[4] = { 'I', 'R', 'C', 'L' };
+	const uint32_t CLIP_FILE_VERSION = 2; // 2 added the quaternion rotation track
+
+	struct ClipFileTrack {
+		uint32_t count;
+		// byte offsets from the start of the file
+		uint32_t timesOffset;
+		uint32_t xOffset;
+		uint32_t yOffset;
+		uint32_t zOffset;
+		uint32_t easeOffset;
+	};
+
+	struct ClipFileQuatTrack {
+		uint32_t count;
+		// byte offsets from the start of the file
+		uint32_t timesOffset;
+		uint32_t xOffset;
+		uint32_t yOffset;
+		uint32_t zOffset;
+		uint32_t wOffset;
+		uint32_t easeOffset;
+	};
+
+	struct ClipFileHeader {
+		char magic[4];
+		uint32_t version;
+		float duration;
+		uint32_t trackCount;
+		ClipFileTrack tracks[TRACK_COUNT];
+		ClipFileQuatTrack orientation;
+		uint32_t eulerOrientation; // 1 if orientation was converted from the Euler rotation keys
+	};
+
+	// Writes clip to filePath, returns false if the file could not be written
+	bool saveClip(const AnimationClip& clip, const char* filePath);
+	bool saveClip(const CompiledClip& clip, const char* filePath);
+	// Reads a clip file back into editable keys
+	bool loadClip(const char* filePath, AnimationClip& clip);
+
+	// Read-only clip sampled in place from a memory-mapped file
+	class MappedClip {
+	public:
+		MappedClip() {};
+		MappedClip(const char* filePath);
+		~MappedClip();
+		MappedClip(const MappedClip&) = delete;
+		MappedClip& operator=(const MappedClip&) = delete;
+
+		// Maps filePath and checks its header, offsets, key order and easing types,
+		// returns false if it is not a valid clip file
+		bool open(const char* filePath);
+		void close();
+		inline bool isOpen()const { return m_data != nullptr; }
+		inline float getDuration()const { return m_duration; }
+		inline const TrackView* getTracks()const { return m_tracks; }
+		inline const QuatTrackView& getOrientation()const { return m_orientation; }
+		inline bool isEulerOrientation()const { return m_eulerOrientation; }
+
+		void sample(float time, ClipCursor& cursor, glm::vec3& position, glm::vec3& rotation, glm::vec3& scale) const {
+			sampleClip(m_tracks, time, cursor, position, rotation, scale);
+		}
+		void sample(float time, ClipCursor& cursor, QuatInterpolation mode, glm::vec3& position, glm::quat& rotation, glm::vec3& scale) const {
+			sampleClip(m_tracks, m_orientation, time, cursor, mode, position, rotation, scale);
+		}
+		glm::vec3 sample(ClipTrack track, float time, KeyCursor& cursor) const {
+			return sampleTrack(m_tracks[track], time, cursor);
+		}
+		glm::quat sampleOrientation(float time, KeyCursor& cursor, QuatInterpolation mode) const {
+			return sampleQuatTrack(m_orientation, time, cursor, mode);
+		}
+	private:
+		const char* m_data = nullptr;
+		size_t m_size = 0;
+		void* m_fileHandle = nullptr; // Windows only
+		void* m_mappingHandle = nullptr; // Windows only
+		float m_duration = -1;
+		TrackView m_tracks[TRACK_COUNT];
+		QuatTrackView m_orientation;
+		bool m_eulerOrientation = false;
+	};
+}
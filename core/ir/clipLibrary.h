@@ -0,0 +1,89 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "animation.h"
+#include "compiledClip.h"
+#include "bakedClip.h"
+#include "compressedClip.h"
+#include "clipFile.h"
+
+// Shared, immutable clip data.
+// A ClipResource is built once (keys, compiled form, optional bake or compression) and never
+// changed afterwards, so any number of Animators can point at the same one.
+// Editing a clip builds a new resource; instances still holding the old handle
+// keep playing it until they are given the new one.
+
+namespace ir {
+	struct ClipResource {
+		AnimationClip source; // keys the clip was built from
+		CompiledClip compiled;
+		float bakeRate; // 0 if the clip is not baked
+		BakedClip baked;
+		BakeReport bakeReport;
+		float compressTolerance; // 0 if the clip is not compressed, ignored when baked
+		CompressedClip compressed;
+		CompressionReport compressionReport;
+
+		ClipResource(const AnimationClip& clip, float rate = 0, float tolerance = 0) : source(clip), compiled(clip), bakeRate(rate), compressTolerance(0) {
+			if (bakeRate > 0) {
+				baked.bake(compiled, bakeRate, &bakeReport);
+			}
+			else if (tolerance > 0) {
+				compressTolerance = tolerance;
+				compressed.compress(clip, compressTolerance, &compressionReport);
+			}
+		}
+
+		float duration() const {
+			return compiled.duration;
+		}
+	};
+
+	typedef std::shared_ptr<const ClipResource> ClipHandle;
+
+	inline ClipHandle makeClip(const AnimationClip& clip, float bakeRate = 0, float compressTolerance = 0) {
+		return std::make_shared<const ClipResource>(clip, bakeRate, compressTolerance);
+	}
+
+	// Named clips. The library holds one reference, every Animator playing a clip holds another,
+	// so a clip stays alive until it is both removed from the library and no longer played.
+	struct ClipLibrary {
+		std::unordered_map<std::string, ClipHandle> clips;
+
+		// Builds a clip from keys, replacing any clip with the same name
+		ClipHandle add(const std::string& name, const AnimationClip& clip, float bakeRate = 0, float compressTolerance = 0) {
+			ClipHandle handle = makeClip(clip, bakeRate, compressTolerance);
+			clips[name] = handle;
+			return handle;
+		}
+
+		// Loads a clip file, returns nullptr if it could not be read.
+		// A compressTolerance above 0 plays the clip from CompressedClip keys instead of the compiled ones.
+		ClipHandle load(const std::string& name, const char* filePath, float bakeRate = 0, float compressTolerance = 0) {
+			AnimationClip clip;
+			if (!loadClip(filePath, clip)) {
+				return nullptr;
+			}
+			return add(name, clip, bakeRate, compressTolerance);
+		}
+
+		// Returns nullptr if there is no clip called name
+		ClipHandle get(const std::string& name) const {
+			auto it = clips.find(name);
+			return it != clips.end() ? it->second : nullptr;
+		}
+
+		void remove(const std::string& name) {
+			clips.erase(name);
+		}
+
+		void clear() {
+			clips.clear();
+		}
+
+		int size() const {
+			return (int)clips.size();
+		}
+	};
+}
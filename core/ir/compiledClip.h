@@ -0,0 +1,376 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include "../ew/alignedMemory.h"
+#include "animation.h"
+#include "fastEasing.h"
+#include "quatTrack.h"
+
+// Packed, playback-only form of an AnimationClip.
+// Every track is stored as separate lanes (times, x, y, z) in one aligned block,
+// so sampling touches a few contiguous cache lines instead of scattered Vec3Keys.
+// Rotations are also compiled into a quaternion track (times, x, y, z, w) that
+// playback can hand straight to ew::Transform::rotation.
+
+namespace ir {
+	const size_t CLIP_LANE_ALIGNMENT = 32; // bytes, one AVX register
+	const int CLIP_LANE_WIDTH = CLIP_LANE_ALIGNMENT / sizeof(float);
+
+	enum ClipTrack {
+		TRACK_POSITION,
+		TRACK_ROTATION,
+		TRACK_SCALE,
+		TRACK_COUNT
+	};
+
+	// Lanes are padded so the next lane starts on an aligned address
+	inline int padLane(int count) {
+		return (count + CLIP_LANE_WIDTH - 1) / CLIP_LANE_WIDTH * CLIP_LANE_WIDTH;
+	}
+
+	// Heap block aligned to CLIP_LANE_ALIGNMENT
+	struct AlignedBuffer {
+		void* data = nullptr;
+		size_t size = 0;
+
+		AlignedBuffer() {
+
+		}
+
+		AlignedBuffer(const AlignedBuffer& other) {
+			allocate(other.size);
+			if (size > 0) {
+				memcpy(data, other.data, size);
+			}
+		}
+
+		AlignedBuffer(AlignedBuffer&& other) noexcept {
+			data = other.data;
+			size = other.size;
+			other.data = nullptr;
+			other.size = 0;
+		}
+
+		AlignedBuffer& operator=(AlignedBuffer other) noexcept {
+			std::swap(data, other.data);
+			std::swap(size, other.size);
+			return *this;
+		}
+
+		~AlignedBuffer() {
+			release();
+		}
+
+		void allocate(size_t bytes) {
+			release();
+			if (bytes > 0) {
+				data = ew::alignedAlloc(bytes, CLIP_LANE_ALIGNMENT);
+				memset(data, 0, bytes);
+				size = bytes;
+			}
+		}
+
+		void release() {
+			if (data != nullptr) {
+				ew::alignedFree(data);
+			}
+			data = nullptr;
+			size = 0;
+		}
+	};
+
+	// Read-only view of one packed track
+	struct TrackView {
+		int count = 0;
+		const float* times = nullptr;
+		const float* x = nullptr;
+		const float* y = nullptr;
+		const float* z = nullptr;
+		const uint8_t* easeTypes = nullptr;
+	};
+
+	// Read-only view of one packed quaternion track
+	struct QuatTrackView {
+		int count = 0;
+		const float* times = nullptr;
+		const float* x = nullptr;
+		const float* y = nullptr;
+		const float* z = nullptr;
+		const float* w = nullptr;
+		const uint8_t* easeTypes = nullptr;
+	};
+
+	// One playback cursor per track of a clip
+	struct ClipCursor {
+		KeyCursor tracks[TRACK_COUNT];
+		KeyCursor orientation;
+
+		void reset() {
+			for (int i = 0; i < TRACK_COUNT; i++) {
+				tracks[i].reset();
+			}
+			orientation.reset();
+		}
+	};
+
+	inline glm::vec3 sampleTrack(const TrackView& track, float time, KeyCursor& cursor) {
+		// default cases
+		if (track.count == 0) {
+			return glm::vec3(0, 0, 0);
+		}
+		if (track.count == 1) {
+			return glm::vec3(track.x[0], track.y[0], track.z[0]);
+		}
+
+		const float* times = track.times;
+		int i = seekKey(cursor, track.count, time, [times](int k) { return times[k]; });
+		int j = i + 1;
+
+		// hold the end values outside of the track
+		float val;
+		if (time <= times[i]) {
+			val = 0;
+		}
+		else if (time >= times[j]) {
+			val = 1;
+		}
+		else {
+			val = easeFast((time - times[i]) / (times[j] - times[i]), track.easeTypes[i]);
+		}
+
+		return glm::vec3(
+			track.x[i] + (track.x[j] - track.x[i]) * val,
+			track.y[i] + (track.y[j] - track.y[i]) * val,
+			track.z[i] + (track.z[j] - track.z[i]) * val
+		);
+	}
+
+	inline glm::quat sampleQuatTrack(const QuatTrackView& track, float time, KeyCursor& cursor, QuatInterpolation mode) {
+		// default cases
+		if (track.count == 0) {
+			return glm::quat(1, 0, 0, 0);
+		}
+
+		int i = 0;
+		int j = 0;
+		float val = 0;
+		if (track.count > 1) {
+			const float* times = track.times;
+			i = seekKey(cursor, track.count, time, [times](int k) { return times[k]; });
+			j = i + 1;
+
+			// hold the end values outside of the track
+			if (time >= times[j]) {
+				val = 1;
+			}
+			else if (time > times[i]) {
+				val = easeFast((time - times[i]) / (times[j] - times[i]), track.easeTypes[i]);
+			}
+		}
+
+		// end values go through the kernel as well, so this matches AnimationSystem's batched sampling
+		return interpolateQuat(
+			glm::quat(track.w[i], track.x[i], track.y[i], track.z[i]),
+			glm::quat(track.w[j], track.x[j], track.y[j], track.z[j]),
+			val, mode);
+	}
+
+	// Samples position, rotation and scale in one pass over the clip's tracks
+	inline void sampleClip(const TrackView* tracks, float time, ClipCursor& cursor, glm::vec3& position, glm::vec3& rotation, glm::vec3& scale) {
+		glm::vec3* out[TRACK_COUNT] = { &position, &rotation, &scale };
+		for (int t = 0; t < TRACK_COUNT; t++) {
+			*out[t] = sampleTrack(tracks[t], time, cursor.tracks[t]);
+		}
+	}
+
+	// Same, with the rotation taken from the quaternion track
+	inline void sampleClip(const TrackView* tracks, const QuatTrackView& orientationTrack, float time, ClipCursor& cursor, QuatInterpolation mode,
+		glm::vec3& position, glm::quat& orientation, glm::vec3& scale) {
+		position = sampleTrack(tracks[TRACK_POSITION], time, cursor.tracks[TRACK_POSITION]);
+		orientation = sampleQuatTrack(orientationTrack, time, cursor.orientation, mode);
+		scale = sampleTrack(tracks[TRACK_SCALE], time, cursor.tracks[TRACK_SCALE]);
+	}
+
+	struct CompiledClip {
+		float duration = -1;
+		TrackView tracks[TRACK_COUNT];
+		QuatTrackView orientation;
+		bool eulerOrientation = false; // orientation was converted from the Euler rotation keys
+		AlignedBuffer buffer;
+
+		CompiledClip() {
+
+		}
+
+		CompiledClip(const AnimationClip& clip) {
+			compile(clip);
+		}
+
+		CompiledClip(const CompiledClip& other) : duration(other.duration), eulerOrientation(other.eulerOrientation), buffer(other.buffer) {
+			rebase(other);
+		}
+
+		CompiledClip& operator=(const CompiledClip& other) {
+			if (this != &other) {
+				duration = other.duration;
+				eulerOrientation = other.eulerOrientation;
+				buffer = other.buffer;
+				rebase(other);
+			}
+			return *this;
+		}
+
+		// Packs the clip's keys. Keys are sorted by time and keys with a negative
+		// (unset) time are skipped, so the editor's key order does not matter.
+		// Without orientation keys the Euler rotation keys are converted here, once,
+		// and neighbouring quaternions are flipped onto the same hemisphere.
+		void compile(const AnimationClip& clip) {
+			duration = clip.duration;
+
+			const std::vector<Vec3Key>* sources[TRACK_COUNT] = { &clip.positionKeys, &clip.rotationKeys, &clip.scaleKeys };
+			std::vector<Vec3Key> keys[TRACK_COUNT];
+			size_t floatCount = 0;
+			size_t easeCount = 0;
+			for (int t = 0; t < TRACK_COUNT; t++) {
+				for (const Vec3Key& key : *sources[t]) {
+					if (key.time >= 0) {
+						keys[t].push_back(key);
+					}
+				}
+				std::stable_sort(keys[t].begin(), keys[t].end(), [](const Vec3Key& a, const Vec3Key& b) { return a.time < b.time; });
+				floatCount += 4 * padLane((int)keys[t].size());
+				easeCount += keys[t].size();
+			}
+
+			std::vector<QuatKey> quatKeys;
+			eulerOrientation = clip.orientationKeys.empty();
+			if (eulerOrientation) {
+				for (const Vec3Key& key : keys[TRACK_ROTATION]) {
+					QuatKey quatKey(glm::quat(key.value), key.time);
+					quatKey.easeType = key.easeType;
+					quatKeys.push_back(quatKey);
+				}
+			}
+			else {
+				for (const QuatKey& key : clip.orientationKeys) {
+					if (key.time >= 0) {
+						quatKeys.push_back(key);
+					}
+				}
+				std::stable_sort(quatKeys.begin(), quatKeys.end(), [](const QuatKey& a, const QuatKey& b) { return a.time < b.time; });
+			}
+			for (size_t k = 0; k < quatKeys.size(); k++) {
+				quatKeys[k].value = glm::normalize(quatKeys[k].value);
+				if (k > 0 && glm::dot(quatKeys[k - 1].value, quatKeys[k].value) < 0) {
+					quatKeys[k].value = -quatKeys[k].value;
+				}
+			}
+			floatCount += 5 * padLane((int)quatKeys.size());
+			easeCount += quatKeys.size();
+
+			buffer.allocate(floatCount * sizeof(float) + easeCount);
+			float* lanes = (float*)buffer.data;
+			uint8_t* easeTypes = (uint8_t*)(lanes + floatCount);
+
+			for (int t = 0; t < TRACK_COUNT; t++) {
+				int count = (int)keys[t].size();
+				int stride = padLane(count);
+				float* times = lanes;
+				float* x = times + stride;
+				float* y = x + stride;
+				float* z = y + stride;
+				for (int k = 0; k < count; k++) {
+					times[k] = keys[t][k].time;
+					x[k] = keys[t][k].value.x;
+					y[k] = keys[t][k].value.y;
+					z[k] = keys[t][k].value.z;
+					easeTypes[k] = (uint8_t)keys[t][k].easeType;
+				}
+
+				tracks[t].count = count;
+				tracks[t].times = times;
+				tracks[t].x = x;
+				tracks[t].y = y;
+				tracks[t].z = z;
+				tracks[t].easeTypes = easeTypes;
+
+				lanes += 4 * stride;
+				easeTypes += count;
+			}
+
+			int count = (int)quatKeys.size();
+			int stride = padLane(count);
+			float* times = lanes;
+			float* x = times + stride;
+			float* y = x + stride;
+			float* z = y + stride;
+			float* w = z + stride;
+			for (int k = 0; k < count; k++) {
+				times[k] = quatKeys[k].time;
+				x[k] = quatKeys[k].value.x;
+				y[k] = quatKeys[k].value.y;
+				z[k] = quatKeys[k].value.z;
+				w[k] = quatKeys[k].value.w;
+				easeTypes[k] = (uint8_t)quatKeys[k].easeType;
+			}
+			orientation.count = count;
+			orientation.times = times;
+			orientation.x = x;
+			orientation.y = y;
+			orientation.z = z;
+			orientation.w = w;
+			orientation.easeTypes = easeTypes;
+		}
+
+		void sample(float time, ClipCursor& cursor, glm::vec3& position, glm::vec3& rotation, glm::vec3& scale) const {
+			sampleClip(tracks, time, cursor, position, rotation, scale);
+		}
+
+		void sample(float time, ClipCursor& cursor, QuatInterpolation mode, glm::vec3& position, glm::quat& rotation, glm::vec3& scale) const {
+			sampleClip(tracks, orientation, time, cursor, mode, position, rotation, scale);
+		}
+
+		glm::vec3 sample(ClipTrack track, float time, KeyCursor& cursor) const {
+			return sampleTrack(tracks[track], time, cursor);
+		}
+
+		glm::quat sampleOrientation(float time, KeyCursor& cursor, QuatInterpolation mode) const {
+			return sampleQuatTrack(orientation, time, cursor, mode);
+		}
+
+	private:
+		// Points the track views at this clip's copy of other's buffer
+		void rebase(const CompiledClip& other) {
+			const char* from = (const char*)other.buffer.data;
+			char* to = (char*)buffer.data;
+			for (int t = 0; t < TRACK_COUNT; t++) {
+				const TrackView& src = other.tracks[t];
+				TrackView& dst = tracks[t];
+				dst.count = src.count;
+				if (from == nullptr) {
+					dst = TrackView();
+					continue;
+				}
+				dst.times = (const float*)(to + ((const char*)src.times - from));
+				dst.x = (const float*)(to + ((const char*)src.x - from));
+				dst.y = (const float*)(to + ((const char*)src.y - from));
+				dst.z = (const float*)(to + ((const char*)src.z - from));
+				dst.easeTypes = (const uint8_t*)(to + ((const char*)src.easeTypes - from));
+			}
+
+			orientation = QuatTrackView();
+			if (from != nullptr) {
+				const QuatTrackView& src = other.orientation;
+				orientation.count = src.count;
+				orientation.times = (const float*)(to + ((const char*)src.times - from));
+				orientation.x = (const float*)(to + ((const char*)src.x - from));
+				orientation.y = (const float*)(to + ((const char*)src.y - from));
+				orientation.z = (const float*)(to + ((const char*)src.z - from));
+				orientation.w = (const float*)(to + ((const char*)src.w - from));
+				orientation.easeTypes = (const uint8_t*)(to + ((const char*)src.easeTypes - from));
+			}
+		}
+	};
+}
@@ -0,0 +1,239 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "compiledClip.h"
+
+// Lossy storage for large clip libraries.
+// Keys the curve can do without are removed, as long as the curve stays within a tolerance
+// at COMPRESSION_SUBSAMPLES points per source segment, and the remaining values are quantized
+// to 16 bits inside each track's bounds. The tolerance is only checked at those points, so it
+// is a target rather than a bound. A key costs 11 bytes (float time, 3x uint16 value, easing)
+// instead of sizeof(Vec3Key).
+
+namespace ir {
+	const int COMPRESSION_SUBSAMPLES = 8; // curve samples compared per source segment
+	const float QUANTIZE_STEPS = 65535.0f;
+
+	struct CompressionReport {
+		size_t bytesBefore = 0; // as authored Vec3Keys
+		size_t bytesAfter = 0;
+		int keysBefore[TRACK_COUNT] = { 0, 0, 0 };
+		int keysAfter[TRACK_COUNT] = { 0, 0, 0 };
+		// Largest distance from the source curve per track, over COMPRESSION_SUBSAMPLES points per
+		// source segment. A sampled estimate, not a bound: the curve can be off by more between them.
+		float sampledMaxError[TRACK_COUNT] = { 0, 0, 0 };
+	};
+
+	struct CompressedTrack {
+		std::vector<float> times;
+		std::vector<uint16_t> values; // x, y, z per key
+		std::vector<uint8_t> easeTypes;
+		glm::vec3 minValue = glm::vec3(0);
+		glm::vec3 extent = glm::vec3(0); // max - min
+
+		int count() const {
+			return (int)times.size();
+		}
+
+		size_t bytes() const {
+			return times.size() * sizeof(float) + values.size() * sizeof(uint16_t) + easeTypes.size() + sizeof(minValue) + sizeof(extent);
+		}
+
+		glm::vec3 decode(int key) const {
+			const uint16_t* q = &values[(size_t)key * 3];
+			return minValue + extent * glm::vec3(q[0], q[1], q[2]) / QUANTIZE_STEPS;
+		}
+
+		void encode(const glm::vec3& value, uint16_t* q) const {
+			for (int c = 0; c < 3; c++) {
+				float normalized = extent[c] > 0 ? (value[c] - minValue[c]) / extent[c] : 0;
+				q[c] = (uint16_t)(std::min(std::max(normalized, 0.0f), 1.0f) * QUANTIZE_STEPS + 0.5f);
+			}
+		}
+
+		glm::vec3 sample(float time, KeyCursor& cursor) const {
+			// default cases
+			if (times.empty()) {
+				return glm::vec3(0, 0, 0);
+			}
+			if (times.size() == 1) {
+				return decode(0);
+			}
+
+			const float* keyTimes = times.data();
+			int i = seekKey(cursor, count(), time, [keyTimes](int k) { return keyTimes[k]; });
+			int j = i + 1;
+
+			// hold the end values outside of the track
+			float val;
+			if (time <= times[i]) {
+				val = 0;
+			}
+			else if (time >= times[j]) {
+				val = 1;
+			}
+			else {
+				val = easeFast((time - times[i]) / (times[j] - times[i]), easeTypes[i]);
+			}
+			glm::vec3 a = decode(i);
+			return a + (decode(j) - a) * val;
+		}
+	};
+
+	struct CompressedClip {
+		float duration = -1;
+		CompressedTrack tracks[TRACK_COUNT];
+
+		void compress(const AnimationClip& clip, float tolerance, CompressionReport* report = nullptr) {
+			CompiledClip source(clip);
+			compress(source, tolerance, report);
+
+			if (report != nullptr) {
+				const std::vector<Vec3Key>* authored[TRACK_COUNT] = { &clip.positionKeys, &clip.rotationKeys, &clip.scaleKeys };
+				report->bytesBefore = 0;
+				for (int t = 0; t < TRACK_COUNT; t++) {
+					report->keysBefore[t] = (int)authored[t]->size();
+					report->bytesBefore += authored[t]->size() * sizeof(Vec3Key);
+				}
+			}
+		}
+
+		void compress(const CompiledClip& source, float tolerance, CompressionReport* report = nullptr) {
+			duration = source.duration;
+			if (report != nullptr) {
+				*report = CompressionReport();
+			}
+
+			for (int t = 0; t < TRACK_COUNT; t++) {
+				const TrackView& track = source.tracks[t];
+				// leave room for the rounding error of quantizing within the track's bounds
+				float quantizeError = 0.5f * glm::length(trackExtent(track)) / QUANTIZE_STEPS;
+				std::vector<int> kept = reduceKeys(track, std::max(tolerance - quantizeError, 0.0f));
+				quantize(track, kept, tracks[t]);
+
+				if (report != nullptr) {
+					report->keysBefore[t] = track.count;
+					report->keysAfter[t] = tracks[t].count();
+					report->bytesBefore += track.count * sizeof(Vec3Key);
+					report->bytesAfter += tracks[t].bytes();
+					report->sampledMaxError[t] = measureError(track, tracks[t]);
+				}
+			}
+		}
+
+		void sample(float time, ClipCursor& cursor, glm::vec3& position, glm::vec3& rotation, glm::vec3& scale) const {
+			position = tracks[TRACK_POSITION].sample(time, cursor.tracks[TRACK_POSITION]);
+			rotation = tracks[TRACK_ROTATION].sample(time, cursor.tracks[TRACK_ROTATION]);
+			scale = tracks[TRACK_SCALE].sample(time, cursor.tracks[TRACK_SCALE]);
+		}
+
+		glm::vec3 sample(ClipTrack track, float time, KeyCursor& cursor) const {
+			return tracks[track].sample(time, cursor);
+		}
+
+	private:
+		static glm::vec3 keyValue(const TrackView& track, int key) {
+			return glm::vec3(track.x[key], track.y[key], track.z[key]);
+		}
+
+		static glm::vec3 trackExtent(const TrackView& track) {
+			if (track.count == 0) {
+				return glm::vec3(0);
+			}
+			glm::vec3 low = keyValue(track, 0);
+			glm::vec3 high = low;
+			for (int k = 1; k < track.count; k++) {
+				low = glm::min(low, keyValue(track, k));
+				high = glm::max(high, keyValue(track, k));
+			}
+			return high - low;
+		}
+
+		// Value of the segment from key first to key last at time, using first's easing
+		static glm::vec3 spanValue(const TrackView& track, int first, int last, float time) {
+			float val = (time - track.times[first]) / (track.times[last] - track.times[first]);
+			val = easeFast(std::min(std::max(val, 0.0f), 1.0f), track.easeTypes[first]);
+			glm::vec3 a = keyValue(track, first);
+			return a + (keyValue(track, last) - a) * val;
+		}
+
+		// Whether one segment from first to last stays within tolerance of the source curve
+		static bool spanFits(const TrackView& track, int first, int last, float tolerance, KeyCursor& cursor) {
+			if (track.times[last] <= track.times[first]) {
+				return last == first + 1;
+			}
+			for (int k = first; k < last; k++) {
+				for (int s = (k == first) ? 1 : 0; s < COMPRESSION_SUBSAMPLES; s++) {
+					float time = track.times[k] + (track.times[k + 1] - track.times[k]) * s / COMPRESSION_SUBSAMPLES;
+					if (glm::length(spanValue(track, first, last, time) - sampleTrack(track, time, cursor)) > tolerance) {
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		// Greedily extends every segment as far as the tolerance allows
+		static std::vector<int> reduceKeys(const TrackView& track, float tolerance) {
+			std::vector<int> kept;
+			if (track.count == 0) {
+				return kept;
+			}
+			KeyCursor cursor;
+			int first = 0;
+			kept.push_back(first);
+			while (first < track.count - 1) {
+				int last = first + 1;
+				while (last + 1 < track.count && spanFits(track, first, last + 1, tolerance, cursor)) {
+					last++;
+				}
+				kept.push_back(last);
+				first = last;
+			}
+			return kept;
+		}
+
+		static void quantize(const TrackView& track, const std::vector<int>& kept, CompressedTrack& out) {
+			out = CompressedTrack();
+			if (kept.empty()) {
+				return;
+			}
+			glm::vec3 low = keyValue(track, kept[0]);
+			glm::vec3 high = low;
+			for (int key : kept) {
+				low = glm::min(low, keyValue(track, key));
+				high = glm::max(high, keyValue(track, key));
+			}
+			out.minValue = low;
+			out.extent = high - low;
+
+			out.times.resize(kept.size());
+			out.values.resize(kept.size() * 3);
+			out.easeTypes.resize(kept.size());
+			for (size_t i = 0; i < kept.size(); i++) {
+				out.times[i] = track.times[kept[i]];
+				out.encode(keyValue(track, kept[i]), &out.values[i * 3]);
+				out.easeTypes[i] = track.easeTypes[kept[i]];
+			}
+		}
+
+		static float measureError(const TrackView& source, const CompressedTrack& compressed) {
+			float maxError = 0;
+			KeyCursor sourceCursor;
+			KeyCursor compressedCursor;
+			for (int k = 0; k < source.count; k++) {
+				int samples = (k + 1 < source.count) ? COMPRESSION_SUBSAMPLES : 1;
+				for (int s = 0; s < samples; s++) {
+					float time = source.times[k];
+					if (s > 0) {
+						time += (source.times[k + 1] - source.times[k]) * s / COMPRESSION_SUBSAMPLES;
+					}
+					glm::vec3 expected = sampleTrack(source, time, sourceCursor);
+					maxError = std::max(maxError, glm::length(compressed.sample(time, compressedCursor) - expected));
+				}
+			}
+			return maxError;
+		}
+	};
+}
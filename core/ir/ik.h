@@ -0,0 +1,478 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include "simd.h"
+#include "quatTrack.h"
+#include "affine.h"
+#include "animHierarchy.h"
+#include "../ew/jobSystem.h"
+
+// Inverse kinematics on flat pose arrays (FlatSkeleton, SkeletonPose or PoseArena instances).
+// Chains read the solved global matrices and write new local rotations, simd::WIDTH chains
+// at a time. Re-run FK afterwards. The FlatSkeleton overloads mark every joint they rotate
+// dirty for the next solveFK(); with raw arrays, mark them yourself (root and mid for two-bone,
+// every chain joint but the tip for FABRIK) or run the full solveFK() on the SkeletonPose.
+// Local rotations are found by expressing world rotations in each joint's frame, which
+// assumes uniform scale along the chain.
+
+namespace ir {
+	const float IK_EPSILON = 1e-6f;
+	const int IK_BATCH_SIZE = 64; // chains per job
+	const int FABRIK_MAX_JOINTS = 16;
+	const int FABRIK_MAX_ITERATIONS = 10;
+	const float FABRIK_TOLERANCE = 1e-3f; // distance from the target that counts as reached
+
+	// Root, mid and end joint, e.g. shoulder, elbow and wrist. Only root and mid rotate.
+	struct TwoBoneIK {
+		JointPose* localPoses = nullptr;
+		const Affine* globalPoses = nullptr; // FK result for localPoses
+		int root = 0;
+		int mid = 0; // descendant of root
+		int end = 0; // descendant of mid
+		glm::vec3 target = glm::vec3(0, 0, 0);
+		glm::vec3 pole = glm::vec3(0, 0, 0); // world position the mid joint bends toward
+		bool usePole = false; // otherwise the chain keeps its current bend plane
+		float error = 0; // out: distance from end to target, non-zero if out of reach
+	};
+
+	// Joints from root to tip, each a descendant of the previous one. Every joint but the tip rotates.
+	struct FABRIKChain {
+		JointPose* localPoses = nullptr;
+		const Affine* globalPoses = nullptr;
+		const int* joints = nullptr;
+		int jointCount = 0; // 2 to FABRIK_MAX_JOINTS
+		glm::vec3 target = glm::vec3(0, 0, 0);
+		int iterations = 0; // out: passes used, 0 if the target was already reached or out of reach
+		float error = 0; // out: distance from tip to target
+	};
+
+	namespace ik {
+		struct Vec3Lanes {
+			simd::vfloat x, y, z;
+		};
+
+		inline Vec3Lanes add3(const Vec3Lanes& a, const Vec3Lanes& b) {
+			return { simd::add(a.x, b.x), simd::add(a.y, b.y), simd::add(a.z, b.z) };
+		}
+
+		inline Vec3Lanes sub3(const Vec3Lanes& a, const Vec3Lanes& b) {
+			return { simd::sub(a.x, b.x), simd::sub(a.y, b.y), simd::sub(a.z, b.z) };
+		}
+
+		inline Vec3Lanes scale3(const Vec3Lanes& a, simd::vfloat s) {
+			return { simd::mul(a.x, s), simd::mul(a.y, s), simd::mul(a.z, s) };
+		}
+
+		inline simd::vfloat dot3(const Vec3Lanes& a, const Vec3Lanes& b) {
+			return simd::madd(a.x, b.x, simd::madd(a.y, b.y, simd::mul(a.z, b.z)));
+		}
+
+		inline Vec3Lanes cross3(const Vec3Lanes& a, const Vec3Lanes& b) {
+			using namespace simd;
+			return {
+				sub(mul(a.y, b.z), mul(a.z, b.y)),
+				sub(mul(a.z, b.x), mul(a.x, b.z)),
+				sub(mul(a.x, b.y), mul(a.y, b.x))
+			};
+		}
+
+		inline simd::vfloat length3(const Vec3Lanes& a) {
+			return simd::sqrt(dot3(a, a));
+		}
+
+		inline Vec3Lanes select3(simd::vfloat mask, const Vec3Lanes& a, const Vec3Lanes& b) {
+			return { simd::select(mask, a.x, b.x), simd::select(mask, a.y, b.y), simd::select(mask, a.z, b.z) };
+		}
+
+		// Zero where a is shorter than IK_EPSILON
+		inline Vec3Lanes normalize3(const Vec3Lanes& a) {
+			using namespace simd;
+			vfloat length = length3(a);
+			vfloat inverseLength = select(cmpgt(length, set(IK_EPSILON)), div(set(1), length), set(0));
+			return scale3(a, inverseLength);
+		}
+
+		// a - n * dot(a, n), n is unit length
+		inline Vec3Lanes reject3(const Vec3Lanes& a, const Vec3Lanes& n) {
+			return sub3(a, scale3(n, dot3(a, n)));
+		}
+
+		// Some unit vector perpendicular to a
+		inline Vec3Lanes orthogonal3(const Vec3Lanes& a) {
+			using namespace simd;
+			vfloat useZ = cmpgt(abs(a.x), abs(a.z));
+			Vec3Lanes o = select3(useZ, Vec3Lanes{ negate(a.y), a.x, set(0) }, Vec3Lanes{ set(0), negate(a.z), a.y });
+			return normalize3(o);
+		}
+
+		inline QuatLanes identity() {
+			using namespace simd;
+			return { set(0), set(0), set(0), set(1) };
+		}
+
+		inline QuatLanes selectQ(simd::vfloat mask, const QuatLanes& a, const QuatLanes& b) {
+			using namespace simd;
+			return { select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z), select(mask, a.w, b.w) };
+		}
+
+		inline QuatLanes conjugate(const QuatLanes& q) {
+			using namespace simd;
+			return { negate(q.x), negate(q.y), negate(q.z), q.w };
+		}
+
+		// a * b, b is applied first
+		inline QuatLanes mulQ(const QuatLanes& a, const QuatLanes& b) {
+			using namespace simd;
+			return {
+				add(madd(a.w, b.x, mul(a.x, b.w)), sub(mul(a.y, b.z), mul(a.z, b.y))),
+				add(madd(a.w, b.y, mul(a.y, b.w)), sub(mul(a.z, b.x), mul(a.x, b.z))),
+				add(madd(a.w, b.z, mul(a.z, b.w)), sub(mul(a.x, b.y), mul(a.y, b.x))),
+				sub(mul(a.w, b.w), madd(a.x, b.x, madd(a.y, b.y, mul(a.z, b.z))))
+			};
+		}
+
+		// Rotates v by the unit quaternion q
+		inline Vec3Lanes rotate(const QuatLanes& q, const Vec3Lanes& v) {
+			Vec3Lanes u = { q.x, q.y, q.z };
+			Vec3Lanes t = cross3(u, v);
+			t = add3(t, t);
+			return add3(add3(v, scale3(t, q.w)), cross3(u, t));
+		}
+
+		// Smallest rotation turning direction from onto direction to.
+		// Opposite directions turn half way around fallbackAxis (unit, perpendicular to from),
+		// zero length directions give the identity.
+		inline QuatLanes shortestArc(const Vec3Lanes& from, const Vec3Lanes& to, const Vec3Lanes& fallbackAxis) {
+			using namespace simd;
+			vfloat lengths = mul(length3(from), length3(to));
+			Vec3Lanes axis = cross3(from, to);
+			vfloat w = add(lengths, dot3(from, to));
+			vfloat opposite = cmplt(w, mul(lengths, set(1e-6f)));
+			axis = select3(opposite, scale3(fallbackAxis, lengths), axis);
+			w = select(opposite, set(0), w);
+			QuatLanes q = normalizeN({ axis.x, axis.y, axis.z, w });
+			return selectQ(cmpgt(lengths, set(IK_EPSILON)), q, identity());
+		}
+
+		// World rotation q as seen from a frame whose linear part has rows rows[0..2]
+		inline QuatLanes toLocal(const Vec3Lanes* rows, const QuatLanes& q) {
+			// transposed linear part * axis, rescaled to the axis' length
+			Vec3Lanes v = add3(add3(scale3(rows[0], q.x), scale3(rows[1], q.y)), scale3(rows[2], q.z));
+			v = scale3(normalize3(v), length3({ q.x, q.y, q.z }));
+			return { v.x, v.y, v.z, q.w };
+		}
+
+		// Per-lane staging, filled one chain at a time then loaded as lanes
+		struct alignas(32) Vec3Scratch {
+			float x[simd::WIDTH], y[simd::WIDTH], z[simd::WIDTH];
+
+			void set(int lane, const glm::vec3& v) {
+				x[lane] = v.x;
+				y[lane] = v.y;
+				z[lane] = v.z;
+			}
+
+			Vec3Lanes load() const {
+				return { simd::load(x), simd::load(y), simd::load(z) };
+			}
+		};
+
+		struct alignas(32) QuatScratch {
+			float x[simd::WIDTH], y[simd::WIDTH], z[simd::WIDTH], w[simd::WIDTH];
+
+			void set(int lane, const glm::quat& q) {
+				x[lane] = q.x;
+				y[lane] = q.y;
+				z[lane] = q.z;
+				w[lane] = q.w;
+			}
+
+			glm::quat get(int lane) const {
+				return glm::quat(w[lane], x[lane], y[lane], z[lane]);
+			}
+
+			QuatLanes load() const {
+				return loadQuatLanes(x, y, z, w);
+			}
+
+			void store(const QuatLanes& q) {
+				storeQuatLanes(q, x, y, z, w);
+			}
+		};
+
+		// Position and linear rows of global matrices
+		struct alignas(32) FrameScratch {
+			Vec3Scratch position;
+			Vec3Scratch rows[3];
+
+			void set(int lane, const Affine& m) {
+				position.set(lane, glm::vec3(m.m[0][3], m.m[1][3], m.m[2][3]));
+				for (int r = 0; r < 3; r++) {
+					rows[r].set(lane, glm::vec3(m.m[r][0], m.m[r][1], m.m[r][2]));
+				}
+			}
+
+			void loadRows(Vec3Lanes* out) const {
+				for (int r = 0; r < 3; r++) {
+					out[r] = rows[r].load();
+				}
+			}
+		};
+
+		// Solves laneCount (1 to simd::WIDTH) chains, spare lanes repeat the last chain
+		inline void solveTwoBoneLanes(TwoBoneIK* chains, int laneCount) {
+			using namespace simd;
+			FrameScratch rootFrame, midFrame;
+			Vec3Scratch endScratch, targetScratch, poleScratch;
+			QuatScratch rootRotation, midRotation;
+			alignas(32) uint32_t usePole[WIDTH];
+			for (int l = 0; l < WIDTH; l++) {
+				const TwoBoneIK& chain = chains[std::min(l, laneCount - 1)];
+				rootFrame.set(l, chain.globalPoses[chain.root]);
+				midFrame.set(l, chain.globalPoses[chain.mid]);
+				const Affine& end = chain.globalPoses[chain.end];
+				endScratch.set(l, glm::vec3(end.m[0][3], end.m[1][3], end.m[2][3]));
+				targetScratch.set(l, chain.target);
+				poleScratch.set(l, chain.pole);
+				rootRotation.set(l, chain.localPoses[chain.root].rotation);
+				midRotation.set(l, chain.localPoses[chain.mid].rotation);
+				usePole[l] = chain.usePole ? MASK_TRUE : MASK_FALSE;
+			}
+			Vec3Lanes rootRows[3], midRows[3];
+			rootFrame.loadRows(rootRows);
+			midFrame.loadRows(midRows);
+			const Vec3Lanes a = rootFrame.position.load();
+			const Vec3Lanes b = midFrame.position.load();
+			const Vec3Lanes c = endScratch.load();
+			const Vec3Lanes target = targetScratch.load();
+			const vfloat hasPole = loadMask(usePole);
+			const vfloat one = set(1);
+
+			Vec3Lanes ba = sub3(a, b);
+			Vec3Lanes bc = sub3(c, b);
+			Vec3Lanes at = sub3(target, a);
+			vfloat lab = length3(ba);
+			vfloat lcb = length3(bc);
+			// root to end distance the chain can actually reach
+			vfloat reach = clamp(length3(at), abs(sub(lab, lcb)), add(lab, lcb));
+
+			// law of cosines for the angle at mid, now and wanted
+			vfloat lengths = max(mul(lab, lcb), set(IK_EPSILON));
+			vfloat cos0 = clamp(div(dot3(ba, bc), lengths), set(-1), one);
+			vfloat cos1 = clamp(div(sub(madd(lab, lab, mul(lcb, lcb)), mul(reach, reach)), add(lengths, lengths)), set(-1), one);
+			vfloat sin0 = sqrt(max(sub(one, mul(cos0, cos0)), set(0)));
+			vfloat sin1 = sqrt(max(sub(one, mul(cos1, cos1)), set(0)));
+			vfloat cosDelta = madd(cos1, cos0, mul(sin1, sin0));
+			vfloat sinDelta = sub(mul(sin1, cos0), mul(cos1, sin0));
+			vfloat halfCos = sqrt(max(mul(add(one, cosDelta), set(0.5f)), set(0)));
+			vfloat halfSin = sqrt(max(mul(sub(one, cosDelta), set(0.5f)), set(0)));
+			halfSin = select(cmplt(sinDelta, set(0)), negate(halfSin), halfSin);
+
+			// bend about the normal of the chain's plane, opening the angle at mid by delta.
+			// A straight chain bends about any perpendicular axis, the pole picks the side below.
+			Vec3Lanes bendAxis = cross3(ba, bc);
+			vfloat straight = cmplt(length3(bendAxis), mul(lengths, set(1e-4f)));
+			bendAxis = select3(straight, orthogonal3(ba), normalize3(bendAxis));
+			QuatLanes bend = { mul(bendAxis.x, halfSin), mul(bendAxis.y, halfSin), mul(bendAxis.z, halfSin), halfCos };
+			Vec3Lanes bentEnd = add3(b, rotate(bend, bc));
+
+			// swing from root so the end points at the target
+			Vec3Lanes rootToEnd = sub3(bentEnd, a);
+			QuatLanes swing = shortestArc(rootToEnd, at, orthogonal3(rootToEnd));
+
+			// twist about the root to target line until mid faces the pole
+			Vec3Lanes n = normalize3(at);
+			Vec3Lanes swungMid = rotate(swing, sub3(b, a));
+			Vec3Lanes toPole = sub3(poleScratch.load(), a);
+			QuatLanes twist = shortestArc(reject3(swungMid, n), reject3(toPole, n), n);
+			QuatLanes rootDelta = mulQ(selectQ(hasPole, twist, identity()), swing);
+
+			Vec3Lanes solvedEnd = add3(a, rotate(rootDelta, rootToEnd));
+			alignas(32) float error[WIDTH];
+			store(error, length3(sub3(solvedEnd, target)));
+
+			rootRotation.store(normalizeN(mulQ(rootRotation.load(), toLocal(rootRows, rootDelta))));
+			midRotation.store(normalizeN(mulQ(midRotation.load(), toLocal(midRows, bend))));
+			for (int l = 0; l < laneCount; l++) {
+				TwoBoneIK& chain = chains[l];
+				chain.localPoses[chain.root].rotation = rootRotation.get(l);
+				chain.localPoses[chain.mid].rotation = midRotation.get(l);
+				chain.error = error[l];
+			}
+		}
+
+		// Solves laneCount chains that all have the same jointCount
+		inline void solveFABRIKLanes(FABRIKChain* chains, int laneCount, int maxIterations, float tolerance) {
+			using namespace simd;
+			const int n = chains[0].jointCount;
+			Vec3Lanes original[FABRIK_MAX_JOINTS];
+			Vec3Lanes p[FABRIK_MAX_JOINTS];
+			vfloat lengths[FABRIK_MAX_JOINTS];
+
+			Vec3Scratch scratch;
+			for (int j = 0; j < n; j++) {
+				for (int l = 0; l < WIDTH; l++) {
+					const FABRIKChain& chain = chains[std::min(l, laneCount - 1)];
+					const Affine& m = chain.globalPoses[chain.joints[j]];
+					scratch.set(l, glm::vec3(m.m[0][3], m.m[1][3], m.m[2][3]));
+				}
+				original[j] = scratch.load();
+				p[j] = original[j];
+			}
+			for (int l = 0; l < WIDTH; l++) {
+				scratch.set(l, chains[std::min(l, laneCount - 1)].target);
+			}
+			const Vec3Lanes target = scratch.load();
+			const Vec3Lanes root = p[0];
+
+			vfloat totalLength = set(0);
+			for (int j = 0; j < n - 1; j++) {
+				lengths[j] = length3(sub3(p[j + 1], p[j]));
+				totalLength = add(totalLength, lengths[j]);
+			}
+
+			// out of reach: stretch straight toward the target
+			vfloat reachable = cmpgt(totalLength, length3(sub3(target, root)));
+			Vec3Lanes toTarget = normalize3(sub3(target, root));
+			for (int j = 0; j < n - 1; j++) {
+				p[j + 1] = select3(reachable, p[j + 1], add3(p[j], scale3(toTarget, lengths[j])));
+			}
+
+			const vfloat tolerances = set(tolerance);
+			vfloat iterations = set(0);
+			vfloat active = bitAnd(reachable, cmpgt(length3(sub3(p[n - 1], target)), tolerances));
+			Vec3Lanes next[FABRIK_MAX_JOINTS];
+			for (int it = 0; it < maxIterations && moveMask(active) != 0; it++) {
+				// backward from the target, then forward from the root
+				next[n - 1] = target;
+				for (int j = n - 2; j >= 0; j--) {
+					next[j] = add3(next[j + 1], scale3(normalize3(sub3(p[j], next[j + 1])), lengths[j]));
+				}
+				next[0] = root;
+				for (int j = 0; j < n - 1; j++) {
+					next[j + 1] = add3(next[j], scale3(normalize3(sub3(next[j + 1], next[j])), lengths[j]));
+				}
+				// converged lanes keep their positions
+				for (int j = 0; j < n; j++) {
+					p[j] = select3(active, next[j], p[j]);
+				}
+				iterations = add(iterations, bitAnd(active, set(1)));
+				active = bitAnd(active, cmpgt(length3(sub3(p[n - 1], target)), tolerances));
+			}
+			alignas(32) float error[WIDTH];
+			alignas(32) float iterationCounts[WIDTH];
+			store(error, length3(sub3(p[n - 1], target)));
+			store(iterationCounts, iterations);
+
+			// turn each bone onto its new direction, root first. accumulated holds the
+			// world rotation already applied by the chain joints above.
+			QuatLanes accumulated = identity();
+			FrameScratch frame;
+			QuatScratch rotation;
+			for (int j = 0; j < n - 1; j++) {
+				for (int l = 0; l < WIDTH; l++) {
+					const FABRIKChain& chain = chains[std::min(l, laneCount - 1)];
+					frame.set(l, chain.globalPoses[chain.joints[j]]);
+					rotation.set(l, chain.localPoses[chain.joints[j]].rotation);
+				}
+				Vec3Lanes rows[3];
+				frame.loadRows(rows);
+
+				Vec3Lanes current = rotate(accumulated, sub3(original[j + 1], original[j]));
+				QuatLanes turn = shortestArc(current, sub3(p[j + 1], p[j]), orthogonal3(current));
+				// the joint's current frame is accumulated * its original global frame
+				Vec3Lanes axis = rotate(conjugate(accumulated), { turn.x, turn.y, turn.z });
+				QuatLanes local = toLocal(rows, { axis.x, axis.y, axis.z, turn.w });
+				rotation.store(normalizeN(mulQ(rotation.load(), local)));
+				accumulated = mulQ(turn, accumulated);
+
+				for (int l = 0; l < laneCount; l++) {
+					FABRIKChain& chain = chains[l];
+					chain.localPoses[chain.joints[j]].rotation = rotation.get(l);
+				}
+			}
+			for (int l = 0; l < laneCount; l++) {
+				chains[l].error = error[l];
+				chains[l].iterations = (int)iterationCounts[l];
+			}
+		}
+	}
+
+	// Analytic two-bone IK, simd::WIDTH chains at a time
+	inline void solveTwoBoneIK(TwoBoneIK* chains, int count) {
+		for (int i = 0; i < count; i += simd::WIDTH) {
+			ik::solveTwoBoneLanes(chains + i, std::min(simd::WIDTH, count - i));
+		}
+	}
+
+	// Iterative FABRIK. Neighbouring chains with the same jointCount share a SIMD pass,
+	// so sort chains by length for the best throughput.
+	// Returns false if a chain had fewer than 2 or more than FABRIK_MAX_JOINTS joints, those are skipped.
+	inline bool solveFABRIK(FABRIKChain* chains, int count, int maxIterations = FABRIK_MAX_ITERATIONS, float tolerance = FABRIK_TOLERANCE) {
+		bool valid = true;
+		int i = 0;
+		while (i < count) {
+			const int jointCount = chains[i].jointCount;
+			if (jointCount < 2 || jointCount > FABRIK_MAX_JOINTS) {
+				chains[i].iterations = 0;
+				valid = false;
+				i++;
+				continue;
+			}
+			int lanes = 1;
+			while (lanes < simd::WIDTH && i + lanes < count && chains[i + lanes].jointCount == jointCount) {
+				lanes++;
+			}
+			ik::solveFABRIKLanes(chains + i, lanes, maxIterations, tolerance);
+			i += lanes;
+		}
+		return valid;
+	}
+
+	// Solves chains on skeleton's poses and marks the joints they rotate dirty, so the next
+	// solveFK(skeleton) applies them. Each chain's localPoses and globalPoses are set to the skeleton's.
+	inline void solveTwoBoneIK(FlatSkeleton& skeleton, TwoBoneIK* chains, int count) {
+		for (int i = 0; i < count; i++) {
+			chains[i].localPoses = skeleton.localPoses.data();
+			chains[i].globalPoses = skeleton.globalMats.data();
+		}
+		solveTwoBoneIK(chains, count);
+		for (int i = 0; i < count; i++) {
+			skeleton.markDirty(chains[i].root);
+			skeleton.markDirty(chains[i].mid);
+		}
+	}
+
+	inline bool solveFABRIK(FlatSkeleton& skeleton, FABRIKChain* chains, int count, int maxIterations = FABRIK_MAX_ITERATIONS, float tolerance = FABRIK_TOLERANCE) {
+		for (int i = 0; i < count; i++) {
+			chains[i].localPoses = skeleton.localPoses.data();
+			chains[i].globalPoses = skeleton.globalMats.data();
+		}
+		bool valid = solveFABRIK(chains, count, maxIterations, tolerance);
+		for (int i = 0; i < count; i++) {
+			if (chains[i].jointCount < 2 || chains[i].jointCount > FABRIK_MAX_JOINTS) {
+				continue;
+			}
+			for (int j = 0; j < chains[i].jointCount - 1; j++) {
+				skeleton.markDirty(chains[i].joints[j]);
+			}
+		}
+		return valid;
+	}
+
+	// Chains are split over the job system in batches of batchSize. Chains in one call
+	// must not write the same joints.
+	inline ew::JobHandle solveTwoBoneIKAsync(ew::JobSystem& jobs, TwoBoneIK* chains, int count, int batchSize = IK_BATCH_SIZE, const ew::JobHandle& dependency = nullptr) {
+		return jobs.parallelFor(count, batchSize, [chains](int begin, int end) {
+			solveTwoBoneIK(chains + begin, end - begin);
+		}, dependency);
+	}
+
+	inline ew::JobHandle solveFABRIKAsync(ew::JobSystem& jobs, FABRIKChain* chains, int count, int maxIterations = FABRIK_MAX_ITERATIONS, float tolerance = FABRIK_TOLERANCE,
+		int batchSize = IK_BATCH_SIZE, const ew::JobHandle& dependency = nullptr) {
+		return jobs.parallelFor(count, batchSize, [chains, maxIterations, tolerance](int begin, int end) {
+			solveFABRIK(chains + begin, end - begin, maxIterations, tolerance);
+		}, dependency);
+	}
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "simd.h"
+#include "fastEasing.h"
+
+// Quaternion interpolation for rotation tracks, simd::WIDTH rotations per call.
+// Quaternions are passed as separate x/y/z/w lanes.
+// Both kernels take the shortest path, normalize their result and return unit quaternions.
+
+namespace ir {
+	enum QuatInterpolation {
+		NLERP, // normalized lerp, cheapest, speeds up slightly mid-segment
+		SLERP // constant angular velocity
+	};
+
+	const char* const quatInterpolationNames[] = {
+		"Nlerp",
+		"Slerp"
+	};
+
+	const float SLERP_MIN_SIN = 1e-4f; // below this the keys are close enough to nlerp
+
+	struct QuatLanes {
+		simd::vfloat x, y, z, w;
+	};
+
+	inline QuatLanes loadQuatLanes(const float* x, const float* y, const float* z, const float* w) {
+		return { simd::load(x), simd::load(y), simd::load(z), simd::load(w) };
+	}
+
+	inline void storeQuatLanes(const QuatLanes& q, float* x, float* y, float* z, float* w) {
+		simd::store(x, q.x);
+		simd::store(y, q.y);
+		simd::store(z, q.z);
+		simd::store(w, q.w);
+	}
+
+	namespace fastmath {
+		// acos(x) for x in [0, 1], Abramowitz & Stegun 4.4.46, error 2e-8
+		inline simd::vfloat acosPositive(simd::vfloat x) {
+			using namespace simd;
+			vfloat p = set(-0.0012624911f);
+			p = madd(p, x, set(0.0066700901f));
+			p = madd(p, x, set(-0.0170881256f));
+			p = madd(p, x, set(0.0308918810f));
+			p = madd(p, x, set(-0.0501743046f));
+			p = madd(p, x, set(0.0889789874f));
+			p = madd(p, x, set(-0.2145988016f));
+			p = madd(p, x, set(1.5707963050f));
+			return mul(sqrt(max(sub(set(1), x), set(0))), p);
+		}
+	}
+
+	inline QuatLanes normalizeN(const QuatLanes& q) {
+		using namespace simd;
+		vfloat lengthSquared = madd(q.x, q.x, madd(q.y, q.y, madd(q.z, q.z, mul(q.w, q.w))));
+		vfloat inverseLength = div(set(1), sqrt(lengthSquared));
+		return { mul(q.x, inverseLength), mul(q.y, inverseLength), mul(q.z, inverseLength), mul(q.w, inverseLength) };
+	}
+
+	// Flips b onto a's hemisphere, returns the (now non-negative) dot product
+	inline simd::vfloat alignN(const QuatLanes& a, QuatLanes& b) {
+		using namespace simd;
+		vfloat d = madd(a.x, b.x, madd(a.y, b.y, madd(a.z, b.z, mul(a.w, b.w))));
+		vfloat flip = cmplt(d, set(0));
+		b.x = select(flip, negate(b.x), b.x);
+		b.y = select(flip, negate(b.y), b.y);
+		b.z = select(flip, negate(b.z), b.z);
+		b.w = select(flip, negate(b.w), b.w);
+		return abs(d);
+	}
+
+	inline QuatLanes nlerpN(const QuatLanes& a, QuatLanes b, simd::vfloat t) {
+		using namespace simd;
+		alignN(a, b);
+		return normalizeN({ lerp(a.x, b.x, t), lerp(a.y, b.y, t), lerp(a.z, b.z, t), lerp(a.w, b.w, t) });
+	}
+
+	inline QuatLanes slerpN(const QuatLanes& a, QuatLanes b, simd::vfloat t) {
+		using namespace simd;
+		vfloat one = set(1);
+		vfloat d = min(alignN(a, b), one);
+		vfloat theta = fastmath::acosPositive(d); // [0, pi/2]
+		vfloat sinTheta = sqrt(max(sub(one, mul(d, d)), set(0)));
+		vfloat inverseSin = div(one, max(sinTheta, set(SLERP_MIN_SIN)));
+		vfloat wa = mul(fastmath::sin(mul(sub(one, t), theta)), inverseSin);
+		vfloat wb = mul(fastmath::sin(mul(t, theta)), inverseSin);
+		// nearly identical keys, fall back to lerp weights
+		vfloat small = cmplt(sinTheta, set(SLERP_MIN_SIN));
+		wa = select(small, sub(one, t), wa);
+		wb = select(small, t, wb);
+		return normalizeN({
+			madd(a.x, wa, mul(b.x, wb)),
+			madd(a.y, wa, mul(b.y, wb)),
+			madd(a.z, wa, mul(b.z, wb)),
+			madd(a.w, wa, mul(b.w, wb))
+		});
+	}
+
+	inline QuatLanes interpolateN(const QuatLanes& a, const QuatLanes& b, simd::vfloat t, QuatInterpolation mode) {
+		return mode == SLERP ? slerpN(a, b, t) : nlerpN(a, b, t);
+	}
+
+	// Interpolates count rotation pairs stored as lanes, t is the (eased) blend per pair
+	inline void interpolateQuats(const float* ax, const float* ay, const float* az, const float* aw,
+		const float* bx, const float* by, const float* bz, const float* bw, const float* t,
+		float* outX, float* outY, float* outZ, float* outW, int count, QuatInterpolation mode) {
+		int i = 0;
+		for (; i + simd::WIDTH <= count; i += simd::WIDTH) {
+			QuatLanes a = loadQuatLanes(ax + i, ay + i, az + i, aw + i);
+			QuatLanes b = loadQuatLanes(bx + i, by + i, bz + i, bw + i);
+			storeQuatLanes(interpolateN(a, b, simd::load(t + i), mode), outX + i, outY + i, outZ + i, outW + i);
+		}
+		// remainder, padded into one register
+		if (i < count) {
+			float lanes[13][simd::WIDTH] = {};
+			for (int lane = 0; lane < count - i; lane++) {
+				const float* in[9] = { ax, ay, az, aw, bx, by, bz, bw, t };
+				for (int k = 0; k < 9; k++) {
+					lanes[k][lane] = in[k][i + lane];
+				}
+			}
+			for (int lane = count - i; lane < simd::WIDTH; lane++) {
+				lanes[3][lane] = lanes[7][lane] = 1; // identity keeps padding finite
+			}
+			QuatLanes a = loadQuatLanes(lanes[0], lanes[1], lanes[2], lanes[3]);
+			QuatLanes b = loadQuatLanes(lanes[4], lanes[5], lanes[6], lanes[7]);
+			storeQuatLanes(interpolateN(a, b, simd::load(lanes[8]), mode), lanes[9], lanes[10], lanes[11], lanes[12]);
+			for (int lane = 0; lane < count - i; lane++) {
+				outX[i + lane] = lanes[9][lane];
+				outY[i + lane] = lanes[10][lane];
+				outZ[i + lane] = lanes[11][lane];
+				outW[i + lane] = lanes[12][lane];
+			}
+		}
+	}
+
+	// Single pair, goes through the same kernel so it matches the batched results
+	inline glm::quat interpolateQuat(const glm::quat& a, const glm::quat& b, float t, QuatInterpolation mode) {
+		using namespace simd;
+		QuatLanes la = { set(a.x), set(a.y), set(a.z), set(a.w) };
+		QuatLanes lb = { set(b.x), set(b.y), set(b.z), set(b.w) };
+		float x[WIDTH], y[WIDTH], z[WIDTH], w[WIDTH];
+		storeQuatLanes(interpolateN(la, lb, set(t), mode), x, y, z, w);
+		return glm::quat(w[0], x[0], y[0], z[0]);
+	}
+}
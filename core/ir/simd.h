@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// Thin wrappers over the widest float vector the compiler targets.
+// AVX (/arch:AVX, -mavx) processes 8 floats, SSE2 (any x64 build) 4 floats,
+// and everything else falls back to one float so kernels still compile.
+
+#if defined(__AVX__)
+#define IR_SIMD_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IR_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace ir {
+	namespace simd {
+#if defined(IR_SIMD_AVX)
+		const int WIDTH = 8;
+		typedef __m256 vfloat;
+
+		inline vfloat load(const float* p) { return _mm256_loadu_ps(p); }
+		inline void store(float* p, vfloat v) { _mm256_storeu_ps(p, v); }
+		inline vfloat set(float x) { return _mm256_set1_ps(x); }
+		inline vfloat add(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+		inline vfloat sub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+		inline vfloat mul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+		inline vfloat div(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+		inline vfloat min(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+		inline vfloat max(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+		inline vfloat sqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+		inline vfloat cmpgt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		inline vfloat cmplt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		inline vfloat bitAnd(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+		inline vfloat bitOr(vfloat a, vfloat b) { return _mm256_or_ps(a, b); }
+		inline vfloat bitXor(vfloat a, vfloat b) { return _mm256_xor_ps(a, b); }
+		// mask lanes are all ones or all zeros
+		inline vfloat select(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }
+		inline vfloat loadMask(const uint32_t* p) { return _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)p)); }
+		inline int moveMask(vfloat mask) { return _mm256_movemask_ps(mask); }
+		inline vfloat abs(vfloat a) { return _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF))); }
+		// nearest integer, ties to even (for |a| < 2^22)
+		inline vfloat round(vfloat a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		// 2^n for integer valued n in [-126, 127], built directly from the exponent bits
+		inline vfloat pow2i(vfloat n) { return _mm256_castsi256_ps(_mm256_cvtps_epi32(_mm256_mul_ps(_mm256_add_ps(n, _mm256_set1_ps(127.0f)), _mm256_set1_ps(8388608.0f)))); }
+#elif defined(IR_SIMD_SSE)
+		const int WIDTH = 4;
+		typedef __m128 vfloat;
+
+		inline vfloat load(const float* p) { return _mm_loadu_ps(p); }
+		inline void store(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+		inline vfloat set(float x) { return _mm_set1_ps(x); }
+		inline vfloat add(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+		inline vfloat sub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+		inline vfloat mul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+		inline vfloat div(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+		inline vfloat min(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+		inline vfloat max(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+		inline vfloat sqrt(vfloat a) { return _mm_sqrt_ps(a); }
+		inline vfloat cmpgt(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+		inline vfloat cmplt(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+		inline vfloat bitAnd(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+		inline vfloat bitOr(vfloat a, vfloat b) { return _mm_or_ps(a, b); }
+		inline vfloat bitXor(vfloat a, vfloat b) { return _mm_xor_ps(a, b); }
+		// mask lanes are all ones or all zeros
+		inline vfloat select(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		inline vfloat loadMask(const uint32_t* p) { return _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)p)); }
+		inline int moveMask(vfloat mask) { return _mm_movemask_ps(mask); }
+		inline vfloat abs(vfloat a) { return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF))); }
+		// nearest integer, ties to even (for |a| < 2^22), adding 1.5 * 2^23 pushes the fraction out of the mantissa
+		inline vfloat round(vfloat a) { return _mm_sub_ps(_mm_add_ps(a, _mm_set1_ps(12582912.0f)), _mm_set1_ps(12582912.0f)); }
+		// 2^n for integer valued n in [-126, 127], built directly from the exponent bits
+		inline vfloat pow2i(vfloat n) { return _mm_castsi128_ps(_mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(n, _mm_set1_ps(127.0f)), _mm_set1_ps(8388608.0f)))); }
+#else
+		const int WIDTH = 1;
+		typedef float vfloat;
+
+		inline uint32_t bits(float a) { uint32_t u; memcpy(&u, &a, 4); return u; }
+		inline float fromBits(uint32_t u) { float a; memcpy(&a, &u, 4); return a; }
+
+		inline vfloat load(const float* p) { return *p; }
+		inline void store(float* p, vfloat v) { *p = v; }
+		inline vfloat set(float x) { return x; }
+		inline vfloat add(vfloat a, vfloat b) { return a + b; }
+		inline vfloat sub(vfloat a, vfloat b) { return a - b; }
+		inline vfloat mul(vfloat a, vfloat b) { return a * b; }
+		inline vfloat div(vfloat a, vfloat b) { return a / b; }
+		inline vfloat min(vfloat a, vfloat b) { return a < b ? a : b; }
+		inline vfloat max(vfloat a, vfloat b) { return a > b ? a : b; }
+		inline vfloat sqrt(vfloat a) { return ::sqrtf(a); }
+		inline vfloat cmpgt(vfloat a, vfloat b) { return fromBits(a > b ? 0xFFFFFFFFu : 0u); }
+		inline vfloat cmplt(vfloat a, vfloat b) { return fromBits(a < b ? 0xFFFFFFFFu : 0u); }
+		inline vfloat bitAnd(vfloat a, vfloat b) { return fromBits(bits(a) & bits(b)); }
+		inline vfloat bitOr(vfloat a, vfloat b) { return fromBits(bits(a) | bits(b)); }
+		inline vfloat bitXor(vfloat a, vfloat b) { return fromBits(bits(a) ^ bits(b)); }
+		inline vfloat select(vfloat mask, vfloat a, vfloat b) { return bits(mask) ? a : b; }
+		inline vfloat loadMask(const uint32_t* p) { return fromBits(*p); }
+		inline int moveMask(vfloat mask) { return bits(mask) >> 31; }
+		inline vfloat abs(vfloat a) { return ::fabsf(a); }
+		inline vfloat round(vfloat a) { return ::nearbyintf(a); }
+		inline vfloat pow2i(vfloat n) { return ::ldexpf(1.0f, (int)n); }
+#endif
+
+		const uint32_t MASK_TRUE = 0xFFFFFFFFu;
+		const uint32_t MASK_FALSE = 0u;
+
+		inline vfloat clamp(vfloat a, vfloat low, vfloat high) {
+			return min(max(a, low), high);
+		}
+
+		inline vfloat negate(vfloat a) {
+			return sub(set(0), a);
+		}
+
+		// a * b + c
+		inline vfloat madd(vfloat a, vfloat b, vfloat c) {
+			return add(mul(a, b), c);
+		}
+
+		// a + (b - a) * t, the same operation order as the scalar lerps
+		inline vfloat lerp(vfloat a, vfloat b, vfloat t) {
+			return add(a, mul(sub(b, a), t));
+		}
+	}
+}
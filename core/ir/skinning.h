@@ -0,0 +1,194 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cmath>
+#include <vector>
+#include <string>
+#include "../ew/mesh.h"
+#include "../ew/model.h"
+#include "../ew/jobSystem.h"
+#include "../ew/skinPalette.h"
+#include "affine.h"
+#include "animHierarchy.h"
+#include "simd.h"
+
+// Linear blend skinning on the CPU.
+// Each frame: buildSkinPalette() from the skeleton's global poses, skinVerticesAsync()
+// from the bind pose into a vertex array, then ew::Mesh::updateVertices() to upload it.
+// Palette entries are column-major mat4s so the same palette can go to a shader.
+// Normals are transformed by the blended linear part and renormalized, which is exact
+// for rotations and uniform scale.
+// GPU path: addSkinPalette() for each instance into one ew::SkinPalette, upload() it once,
+// then draw each instance with skinned.vert and _PaletteOffset set to the returned offset.
+
+namespace ir {
+	const int SKIN_BATCH_SIZE = 1024; // vertices per job
+
+	// How a model's bones attach to a skeleton, built once
+	struct SkinBinding {
+		std::vector<int> boneJoints; // joint index per bone, -1 if the skeleton has no joint with the bone's name
+		std::vector<Affine> inverseBinds; // bone offset matrices
+
+		int size() const {
+			return (int)boneJoints.size();
+		}
+	};
+
+	// Matches bones to joints by name
+	inline SkinBinding bindSkin(const std::vector<ew::Bone>& bones, const FlatSkeleton& skeleton) {
+		SkinBinding binding;
+		for (const ew::Bone& bone : bones) {
+			int joint = -1;
+			for (int i = 0; i < skeleton.size(); i++) {
+				if (skeleton.joints[i]->name != nullptr && bone.name == skeleton.joints[i]->name) {
+					joint = i;
+					break;
+				}
+			}
+			binding.boneJoints.push_back(joint);
+			binding.inverseBinds.push_back(affineFromMat4(bone.offset));
+		}
+		return binding;
+	}
+
+	// palette[b] = globalPoses[joint of b] * inverse bind of b. Unbound bones keep the bind pose.
+	inline void buildSkinPalette(const SkinBinding& binding, const Affine* globalPoses, glm::mat4* palette) {
+		for (int b = 0; b < binding.size(); b++) {
+			int joint = binding.boneJoints[b];
+			palette[b] = (joint < 0) ? glm::mat4(1.0f) : toMat4(compose(globalPoses[joint], binding.inverseBinds[b]));
+		}
+	}
+
+	// Appends one instance's palette to the shared GPU palette, returns its offset
+	inline int addSkinPalette(ew::SkinPalette& gpuPalette, const SkinBinding& binding, const Affine* globalPoses) {
+		int offset = gpuPalette.allocate(binding.size());
+		buildSkinPalette(binding, globalPoses, gpuPalette.data() + offset);
+		return offset;
+	}
+
+	// Deforms vertices [begin, end) of in into out. Vertices without weights are copied unchanged.
+	inline void skinVertices(const ew::Vertex* in, const ew::SkinWeights* weights, const glm::mat4* palette, ew::Vertex* out, int begin, int end) {
+		for (int v = begin; v < end; v++) {
+			const ew::Vertex& src = in[v];
+			const ew::SkinWeights& skin = weights[v];
+			ew::Vertex& dst = out[v];
+			if (skin.weights.x + skin.weights.y + skin.weights.z + skin.weights.w == 0) {
+				dst = src;
+				continue;
+			}
+
+			float position[4];
+			float normal[4];
+#if defined(IR_SIMD_AVX)
+			// columns 0 and 1 in one register, 2 and 3 in the other
+			__m256 c01 = _mm256_setzero_ps();
+			__m256 c23 = _mm256_setzero_ps();
+			for (int k = 0; k < ew::MAX_BONE_INFLUENCES; k++) {
+				if (skin.weights[k] == 0) {
+					continue;
+				}
+				const float* m = &palette[skin.bones[k]][0][0];
+				__m256 w = _mm256_set1_ps(skin.weights[k]);
+				c01 = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_loadu_ps(m), w));
+				c23 = _mm256_add_ps(c23, _mm256_mul_ps(_mm256_loadu_ps(m + 8), w));
+			}
+			const glm::vec3& p = src.pos;
+			const glm::vec3& n = src.normal;
+			__m256 pos = _mm256_add_ps(
+				_mm256_mul_ps(c01, _mm256_setr_ps(p.x, p.x, p.x, p.x, p.y, p.y, p.y, p.y)),
+				_mm256_mul_ps(c23, _mm256_setr_ps(p.z, p.z, p.z, p.z, 1, 1, 1, 1)));
+			__m256 nrm = _mm256_add_ps(
+				_mm256_mul_ps(c01, _mm256_setr_ps(n.x, n.x, n.x, n.x, n.y, n.y, n.y, n.y)),
+				_mm256_mul_ps(c23, _mm256_setr_ps(n.z, n.z, n.z, n.z, 0, 0, 0, 0)));
+			_mm_storeu_ps(position, _mm_add_ps(_mm256_castps256_ps128(pos), _mm256_extractf128_ps(pos, 1)));
+			_mm_storeu_ps(normal, _mm_add_ps(_mm256_castps256_ps128(nrm), _mm256_extractf128_ps(nrm, 1)));
+#elif defined(IR_SIMD_SSE)
+			__m128 c[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+			for (int k = 0; k < ew::MAX_BONE_INFLUENCES; k++) {
+				if (skin.weights[k] == 0) {
+					continue;
+				}
+				const float* m = &palette[skin.bones[k]][0][0];
+				__m128 w = _mm_set1_ps(skin.weights[k]);
+				for (int col = 0; col < 4; col++) {
+					c[col] = _mm_add_ps(c[col], _mm_mul_ps(_mm_loadu_ps(m + col * 4), w));
+				}
+			}
+			const glm::vec3& p = src.pos;
+			const glm::vec3& n = src.normal;
+			__m128 pos = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(c[0], _mm_set1_ps(p.x)), _mm_mul_ps(c[1], _mm_set1_ps(p.y))),
+				_mm_add_ps(_mm_mul_ps(c[2], _mm_set1_ps(p.z)), c[3]));
+			__m128 nrm = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(c[0], _mm_set1_ps(n.x)), _mm_mul_ps(c[1], _mm_set1_ps(n.y))),
+				_mm_mul_ps(c[2], _mm_set1_ps(n.z)));
+			_mm_storeu_ps(position, pos);
+			_mm_storeu_ps(normal, nrm);
+#else
+			glm::mat4 m(0.0f);
+			for (int k = 0; k < ew::MAX_BONE_INFLUENCES; k++) {
+				if (skin.weights[k] == 0) {
+					continue;
+				}
+				for (int col = 0; col < 4; col++) {
+					m[col] += palette[skin.bones[k]][col] * skin.weights[k];
+				}
+			}
+			glm::vec4 pos = m * glm::vec4(src.pos, 1.0f);
+			glm::vec4 nrm = m * glm::vec4(src.normal, 0.0f);
+			for (int i = 0; i < 4; i++) {
+				position[i] = pos[i];
+				normal[i] = nrm[i];
+			}
+#endif
+			dst.pos = glm::vec3(position[0], position[1], position[2]);
+			float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			float scale = (length > 0) ? 1.0f / length : 0.0f;
+			dst.normal = glm::vec3(normal[0] * scale, normal[1] * scale, normal[2] * scale);
+			dst.uv = src.uv;
+		}
+	}
+
+	// Skins every vertex of bindPose into out (at least bindPose.vertices.size() long) on the job system.
+	// palette and out must stay alive until the returned handle completes.
+	inline ew::JobHandle skinVerticesAsync(ew::JobSystem& jobs, const ew::MeshData& bindPose, const glm::mat4* palette, ew::Vertex* out,
+		int batchSize = SKIN_BATCH_SIZE, const ew::JobHandle& dependency = nullptr) {
+		const ew::Vertex* in = bindPose.vertices.data();
+		const ew::SkinWeights* weights = bindPose.skinWeights.data();
+		return jobs.parallelFor((int)bindPose.vertices.size(), batchSize, [in, weights, palette, out](int begin, int end) {
+			skinVertices(in, weights, palette, out, begin, end);
+		}, dependency);
+	}
+
+	inline void skinVertices(ew::JobSystem& jobs, const ew::MeshData& bindPose, const glm::mat4* palette, ew::Vertex* out, int batchSize = SKIN_BATCH_SIZE) {
+		jobs.wait(skinVerticesAsync(jobs, bindPose, palette, out, batchSize));
+	}
+
+	// Skinned copy of one of a model's meshes, owns the palette and deformed vertices
+	struct SkinnedMesh {
+		ew::Model* model = nullptr;
+		int meshIndex = 0;
+		SkinBinding binding;
+		std::vector<glm::mat4> palette;
+		std::vector<ew::Vertex> vertices; // last skinned result
+
+		SkinnedMesh() {
+
+		}
+
+		SkinnedMesh(ew::Model* theModel, int theMeshIndex, const FlatSkeleton& skeleton) {
+			model = theModel;
+			meshIndex = theMeshIndex;
+			binding = bindSkin(model->getBones(), skeleton);
+			palette.resize(binding.size());
+			vertices = model->getMeshData(meshIndex).vertices;
+		}
+
+		// Deforms the mesh to globalPoses and streams the result into the model's vertex buffer
+		void update(ew::JobSystem& jobs, const Affine* globalPoses) {
+			buildSkinPalette(binding, globalPoses, palette.data());
+			const ew::MeshData& bindPose = model->getMeshData(meshIndex);
+			skinVertices(jobs, bindPose, palette.data(), vertices.data());
+			model->getMesh(meshIndex).updateVertices(vertices.data(), (int)vertices.size());
+		}
+	};
+}
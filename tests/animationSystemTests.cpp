@@ -0,0 +1,143 @@
+#include <ir/animationSystem.h>
+#include "test.h"
+
+//AnimationSystem's SIMD update and sample against the scalar reference
+
+static ir::AnimationClip makeClip(float duration, int keyCount, float offset) {
+	ir::AnimationClip clip;
+	clip.duration = duration;
+	for (int k = 0; k < keyCount; k++) {
+		float time = duration * k / (keyCount - 1);
+		ir::Vec3Key position(glm::vec3(k + offset, 2.0f * k - offset, -k * offset), time);
+		ir::Vec3Key rotation(glm::vec3(0.3f * k, -0.2f * k + offset, 0.1f * offset), time);
+		ir::Vec3Key scale(glm::vec3(1.0f + 0.1f * k, 1.0f, 1.0f + 0.05f * offset * k), time);
+		//every easing type shows up on some segment
+		position.easeType = k % (int)ir::EASING_FUNCTIONS.size();
+		rotation.easeType = (k + 1) % (int)ir::EASING_FUNCTIONS.size();
+		scale.easeType = (k + 2) % (int)ir::EASING_FUNCTIONS.size();
+		clip.positionKeys.push_back(position);
+		clip.rotationKeys.push_back(rotation);
+		clip.scaleKeys.push_back(scale);
+		ir::QuatKey orientation(glm::angleAxis(0.7f * k + offset, glm::normalize(glm::vec3(1, offset, 0.5f))), time);
+		orientation.easeType = (k + 3) % (int)ir::EASING_FUNCTIONS.size();
+		clip.orientationKeys.push_back(orientation);
+	}
+	return clip;
+}
+
+static void checkSame(const ir::AnimationSystem& simd, const ir::AnimationSystem& scalar, int frame) {
+	const float tolerance = 1e-4f; //fast easing kernels are within ~5e-7 of ir::ease, values are up to ~10
+	for (int i = 0; i < simd.size(); i++) {
+		bool same = true;
+		same &= CHECK_NEAR(simd.playbackTimes[i], scalar.playbackTimes[i], 1e-5);
+		for (int c = 0; c < 3; c++) {
+			same &= CHECK_NEAR(simd.positions[i][c], scalar.positions[i][c], tolerance);
+			same &= CHECK_NEAR(simd.rotations[i][c], scalar.rotations[i][c], tolerance);
+			same &= CHECK_NEAR(simd.scales[i][c], scalar.scales[i][c], tolerance);
+		}
+		for (int c = 0; c < 4; c++) {
+			same &= CHECK_NEAR(simd.orientations[i][c], scalar.orientations[i][c], tolerance);
+		}
+		if (!same) {
+			printf("  instance %d, frame %d\n", i, frame);
+			return;
+		}
+	}
+}
+
+//Plays the same instances through both paths and compares every frame
+static void testMatchesScalar(int instanceCount) {
+	ir::ClipHandle clips[] = {
+		ir::makeClip(makeClip(2.0f, 5, 0.0f)),
+		ir::makeClip(makeClip(0.75f, 2, 0.5f)),
+		ir::makeClip(makeClip(3.0f, 9, -1.0f)),
+	};
+	//single key and empty tracks take their own path through the gather
+	ir::AnimationClip sparse = makeClip(1.0f, 2, 0.25f);
+	sparse.positionKeys.resize(1);
+	sparse.scaleKeys.clear();
+	sparse.orientationKeys.clear();
+	ir::ClipHandle sparseClip = ir::makeClip(sparse);
+
+	ir::AnimationSystem simd;
+	ir::AnimationSystem scalar;
+	simd.useSimd = true;
+	scalar.useSimd = false;
+	for (int i = 0; i < instanceCount; i++) {
+		ir::ClipHandle clip = (i % 7 == 6) ? sparseClip : clips[i % 3];
+		bool playing = i % 5 != 4;
+		bool looping = i % 2 == 0;
+		//backwards, slow, fast, and faster than one clip per frame
+		float speeds[] = { 1.0f, -1.0f, 0.5f, 2.5f, -3.0f, 40.0f };
+		float speed = speeds[i % 6];
+		simd.addInstance(clip, playing, looping, speed);
+		scalar.addInstance(clip, playing, looping, speed);
+		simd.playbackTimes[i] = scalar.playbackTimes[i] = 0.1f * (i % 11);
+	}
+	//frame times that land exactly on and around clip boundaries
+	const float deltas[] = { 1.0f / 60, 0.25f, 1.0f / 30, 0.5f, 0.001f };
+	for (int frame = 0; frame < 300; frame++) {
+		float dt = deltas[frame % 5];
+		simd.update(dt);
+		scalar.update(dt);
+		simd.sample();
+		scalar.sample();
+		checkSame(simd, scalar, frame);
+	}
+}
+
+//Instances moved to another clip keep matching
+static void testSetClip() {
+	ir::ClipHandle first = ir::makeClip(makeClip(2.0f, 5, 0.0f));
+	ir::ClipHandle second = ir::makeClip(makeClip(1.0f, 3, 1.0f));
+	ir::AnimationSystem simd;
+	ir::AnimationSystem scalar;
+	scalar.useSimd = false;
+	for (int i = 0; i < 2 * ir::simd::WIDTH + 1; i++) {
+		simd.addInstance(first, true, true);
+		scalar.addInstance(first, true, true);
+	}
+	for (int frame = 0; frame < 60; frame++) {
+		if (frame == 30) {
+			for (int i = 0; i < simd.size(); i += 2) {
+				simd.setClip(i, second);
+				scalar.setClip(i, second);
+			}
+			CHECK(simd.playbackTimes[0] <= second->duration());
+		}
+		simd.update(0.05f);
+		scalar.update(0.05f);
+		simd.sample();
+		scalar.sample();
+		checkSame(simd, scalar, frame);
+	}
+}
+
+//Null clips are refused, so update() and sample() never see one
+static void testNullClip() {
+	ir::ClipHandle clip = ir::makeClip(makeClip(1.0f, 3, 0.0f));
+	ir::AnimationSystem system;
+	CHECK(system.addInstance(nullptr) == -1);
+	CHECK(system.size() == 0);
+	int instance = system.addInstance(clip);
+	CHECK(instance == 0);
+	CHECK(!system.setClip(instance, nullptr));
+	CHECK(system.clips[instance] == clip);
+	for (int simd = 0; simd < 2; simd++) {
+		system.useSimd = simd != 0;
+		system.update(0.1f);
+		system.sample();
+	}
+	CHECK(system.size() == 1);
+}
+
+int main() {
+	//full registers, lane tails of every length, and fewer instances than one register
+	for (int count = 1; count <= 3 * ir::simd::WIDTH + 1; count++) {
+		testMatchesScalar(count);
+	}
+	testMatchesScalar(1000);
+	testSetClip();
+	testNullClip();
+	return test::testResult();
+}
@@ -0,0 +1,95 @@
+#include <ir/animator.h>
+#include <ir/compressedClip.h>
+#include "test.h"
+
+//CompressedClip against the compiled clip it was built from, sampled far more densely than compression checks
+
+const float TOLERANCE = 0.01f;
+const int DENSE_SAMPLES = 10000;
+
+//200 keys on a line with a small wobble, so most keys can go but not all of them
+static ir::AnimationClip makeNearLinearClip() {
+	ir::AnimationClip clip;
+	clip.duration = 4.0f;
+	const int keyCount = 200;
+	for (int k = 0; k < keyCount; k++) {
+		float time = clip.duration * k / (keyCount - 1);
+		float wobble = 0.03f * std::sin(time * 7.0f);
+		clip.positionKeys.push_back(ir::Vec3Key(glm::vec3(time, 2.0f * time + wobble, -0.5f * time), time));
+		clip.rotationKeys.push_back(ir::Vec3Key(glm::vec3(0.1f * time, wobble, 0.0f), time));
+		clip.scaleKeys.push_back(ir::Vec3Key(glm::vec3(1.0f + 0.05f * time), time));
+	}
+	return clip;
+}
+
+//Largest distance between the compressed and compiled tracks over evenly spaced times
+static float denseError(const ir::CompiledClip& source, const ir::CompressedClip& compressed, ir::ClipTrack track) {
+	ir::KeyCursor sourceCursor;
+	ir::KeyCursor compressedCursor;
+	float error = 0;
+	for (int s = 0; s <= DENSE_SAMPLES; s++) {
+		float time = source.duration * s / DENSE_SAMPLES;
+		glm::vec3 expected = source.sample(track, time, sourceCursor);
+		error = std::max(error, glm::length(compressed.sample(track, time, compressedCursor) - expected));
+	}
+	return error;
+}
+
+static void testNearLinearTrack() {
+	ir::AnimationClip clip = makeNearLinearClip();
+	ir::CompiledClip source(clip);
+	ir::CompressedClip compressed;
+	ir::CompressionReport report;
+	compressed.compress(clip, TOLERANCE, &report);
+
+	CHECK(report.bytesBefore == clip.positionKeys.size() * 3 * sizeof(ir::Vec3Key));
+	CHECK(report.bytesAfter < report.bytesBefore);
+	for (int t = 0; t < ir::TRACK_COUNT; t++) {
+		CHECK(report.keysBefore[t] == 200);
+		CHECK(report.keysAfter[t] >= 2);
+		if (!CHECK(report.keysAfter[t] < report.keysBefore[t])) {
+			printf("  track %d kept every key\n", t);
+		}
+		float error = denseError(source, compressed, (ir::ClipTrack)t);
+		if (!CHECK(error <= TOLERANCE)) {
+			printf("  track %d, dense error %g\n", t, error);
+		}
+		CHECK(report.sampledMaxError[t] <= TOLERANCE);
+	}
+}
+
+//A compress tolerance on the resource makes Animator play the compressed keys
+static void testAnimatorPlaysCompressed() {
+	ir::AnimationClip clip = makeNearLinearClip();
+	ir::ClipHandle plain = ir::makeClip(clip);
+	ir::ClipHandle compressed = ir::makeClip(clip, 0, TOLERANCE);
+	CHECK(plain->compressTolerance == 0);
+	CHECK(compressed->compressTolerance == TOLERANCE);
+	CHECK(compressed->compressionReport.bytesAfter < compressed->compressionReport.bytesBefore);
+
+	ir::Animator a(plain);
+	ir::Animator b(compressed);
+	for (int frame = 0; frame < 240; frame++) {
+		a.playbackTime = b.playbackTime = clip.duration * frame / 239;
+		glm::vec3 position, rotation, scale;
+		glm::vec3 expectedPosition, expectedRotation, expectedScale;
+		a.sample(expectedPosition, expectedRotation, expectedScale);
+		b.sample(position, rotation, scale);
+		bool near = CHECK(glm::length(position - expectedPosition) <= TOLERANCE);
+		near &= CHECK(glm::length(rotation - expectedRotation) <= TOLERANCE);
+		near &= CHECK(glm::length(scale - expectedScale) <= TOLERANCE);
+		//exactly the compressed keys, not the compiled ones
+		ir::KeyCursor cursor;
+		near &= CHECK(b.samplePosition() == compressed->compressed.sample(ir::TRACK_POSITION, b.playbackTime, cursor));
+		if (!near) {
+			printf("  frame %d\n", frame);
+			return;
+		}
+	}
+}
+
+int main() {
+	testNearLinearTrack();
+	testAnimatorPlaysCompressed();
+	return test::testResult();
+}
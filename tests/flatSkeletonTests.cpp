@@ -0,0 +1,197 @@
+#include <ir/animHierarchy.h>
+#include "test.h"
+#include <random>
+
+//Affine math and flat FK (full, dirty-only and batched) against ew::Transform::modelMatrix and glm::mat4 products
+
+static std::mt19937 rng(12345);
+
+static float randomFloat(float min, float max) {
+	return std::uniform_real_distribution<float>(min, max)(rng);
+}
+
+static ew::Transform randomPose() {
+	ew::Transform pose;
+	pose.position = glm::vec3(randomFloat(-2, 2), randomFloat(-2, 2), randomFloat(-2, 2));
+	pose.rotation = glm::normalize(glm::quat(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1)));
+	pose.scale = glm::vec3(randomFloat(0.5f, 1.5f), randomFloat(0.5f, 1.5f), randomFloat(0.5f, 1.5f));
+	return pose;
+}
+
+//Mostly deep chains with some branching and several roots
+static ir::Skeleton randomSkeleton(int jointCount) {
+	ir::SkeletonBuilder builder;
+	for (int i = 0; i < jointCount; i++) {
+		int parent = -1;
+		if (i > 0 && randomFloat(0, 1) > 0.05f) {
+			parent = randomFloat(0, 1) < 0.7f ? i - 1 : (int)randomFloat(0, (float)i - 0.01f);
+		}
+		builder.addJoint(nullptr, parent, randomPose());
+	}
+	return builder.build();
+}
+
+//a against a glm matrix, b's last row is (0, 0, 0, 1)
+static bool sameAffine(const ir::Affine& a, const glm::mat4& b) {
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 4; c++) {
+			//values grow with depth, so compare relative to their size
+			double tolerance = 1e-5 * (1.0 + std::fabs(b[c][r]));
+			if (std::fabs(a.m[r][c] - b[c][r]) > tolerance) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//Global matrix from ew::Transform::modelMatrix and glm products, without any Affine code
+static glm::mat4 referenceGlobal(const ir::Joint* joint) {
+	glm::mat4 local = joint->localPose.modelMatrix();
+	return joint->parent != nullptr ? referenceGlobal(joint->parent) * local : local;
+}
+
+//Every flat matrix equals the glm result for the joint it was built from
+static bool matchesRecursive(const ir::FlatSkeleton& flat) {
+	for (int i = 0; i < flat.size(); i++) {
+		const ir::Joint* joint = flat.joints[i];
+		if (!CHECK(sameAffine(flat.localMats[i], joint->localPose.modelMatrix())) || !CHECK(sameAffine(flat.globalMats[i], referenceGlobal(joint)))) {
+			printf("  flat joint %d\n", i);
+			return false;
+		}
+	}
+	return true;
+}
+
+static glm::vec3 randomScale() {
+	return glm::vec3(randomFloat(0.5f, 1.5f), randomFloat(0.5f, 1.5f), randomFloat(0.5f, 1.5f));
+}
+
+//Affine construction, compose and inverse against the same operations on glm::mat4
+static void testAffine() {
+	for (int i = 0; i < 1000; i++) {
+		ew::Transform ta = randomPose();
+		ew::Transform tb = randomPose();
+		//non-uniform scale on both sides, inverse has to undo it
+		ta.scale = randomScale();
+		glm::mat4 ma = ta.modelMatrix();
+		glm::mat4 mb = tb.modelMatrix();
+		ir::Affine a = ir::affineTRS(ta.position, ta.rotation, ta.scale);
+		ir::Affine b = ir::affineTRS(tb.position, tb.rotation, tb.scale);
+
+		bool ok = CHECK(sameAffine(a, ma));
+		ok &= CHECK(sameAffine(ir::affineFromMat4(ma), ma));
+		ok &= CHECK(sameAffine(ir::compose(a, b), ma * mb));
+		ok &= CHECK(sameAffine(ir::inverse(a), glm::inverse(ma)));
+		ok &= CHECK(sameAffine(ir::compose(a, ir::inverse(a)), glm::mat4(1.0f)));
+		glm::mat4 back = ir::toMat4(a);
+		ok &= CHECK(sameAffine(a, back));
+		ok &= CHECK(back[0][3] == 0 && back[1][3] == 0 && back[2][3] == 0 && back[3][3] == 1);
+		if (!ok) {
+			printf("  pair %d\n", i);
+			return;
+		}
+	}
+}
+
+static void testFullSolve() {
+	const int sizes[] = { 1, 2, 17, 200 };
+	for (int size : sizes) {
+		ir::Skeleton skeleton = randomSkeleton(size);
+		ir::FlatSkeleton flat = ir::flatten(skeleton);
+		CHECK(flat.size() == size);
+		//parents come first and subtrees are contiguous
+		for (int i = 0; i < flat.size(); i++) {
+			CHECK(flat.parents[i] < i);
+			CHECK(flat.subtreeEnds[i] > i && flat.subtreeEnds[i] <= flat.size());
+			if (flat.parents[i] >= 0) {
+				CHECK(flat.subtreeEnds[i] <= flat.subtreeEnds[flat.parents[i]]);
+			}
+		}
+		ir::solveFK(flat);
+		CHECK(flat.recomputedJoints == size);
+		matchesRecursive(flat);
+	}
+}
+
+//Editing a few joints per frame only recomputes their subtrees and still matches
+static void testDirtySolve() {
+	ir::Skeleton skeleton = randomSkeleton(120);
+	ir::FlatSkeleton flat = ir::flatten(skeleton);
+	ir::solveFK(flat);
+
+	ir::solveFK(flat);
+	CHECK(flat.recomputedJoints == 0);
+
+	for (int frame = 0; frame < 100; frame++) {
+		std::vector<bool> inDirtySubtree(flat.size(), false);
+		int edits = 1 + frame % 4;
+		for (int e = 0; e < edits; e++) {
+			int index = (int)randomFloat(0, flat.size() - 0.01f);
+			flat.joints[index]->localPose = randomPose();
+			flat.jointChanged(flat.joints[index]);
+			for (int i = index; i < flat.subtreeEnds[index]; i++) {
+				inDirtySubtree[i] = true;
+			}
+		}
+		int expected = 0;
+		for (bool dirty : inDirtySubtree) {
+			expected += dirty;
+		}
+		ir::solveFK(flat);
+		CHECK(flat.recomputedJoints == expected);
+		if (!matchesRecursive(flat)) {
+			printf("  frame %d\n", frame);
+			return;
+		}
+	}
+}
+
+//Instances in a PoseArena, single threaded and on the job system
+static void testBatchSolve() {
+	ir::Skeleton skeleton = randomSkeleton(40);
+	ir::FlatSkeleton flat = ir::flatten(skeleton);
+	ir::solveFK(flat);
+	ir::PoseArena arena(flat, 37);
+	std::vector<std::vector<ew::Transform>> poses;
+	for (int p = 0; p < arena.capacity(); p++) {
+		ir::SkeletonPose* pose = arena.create();
+		poses.push_back(std::vector<ew::Transform>());
+		for (int i = 0; i < flat.size(); i++) {
+			poses[p].push_back(randomPose());
+			pose->localPoses[i] = ir::JointPose(poses[p][i]);
+		}
+	}
+	CHECK(arena.create() == nullptr);
+
+	ew::JobSystem jobs(3);
+	for (int threaded = 0; threaded < 2; threaded++) {
+		if (threaded) {
+			arena.solve(jobs);
+		}
+		else {
+			arena.solve();
+		}
+		for (int p = 0; p < arena.size(); p++) {
+			for (int i = 0; i < flat.size(); i++) {
+				flat.joints[i]->localPose = poses[p][i];
+			}
+			bool same = true;
+			for (int i = 0; i < flat.size() && same; i++) {
+				same = CHECK(sameAffine(arena.poses[p].globalPoses[i], referenceGlobal(flat.joints[i])));
+			}
+			if (!same) {
+				printf("  pose %d, threaded %d\n", p, threaded);
+				return;
+			}
+		}
+	}
+}
+
+int main() {
+	testAffine();
+	testFullSolve();
+	testDirtySolve();
+	testBatchSolve();
+	return test::testResult();
+}
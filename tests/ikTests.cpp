@@ -0,0 +1,206 @@
+#include <ir/ik.h>
+#include "test.h"
+#include <random>
+
+//Two-bone IK and FABRIK on a FlatSkeleton, checked by running FK on the result
+
+static std::mt19937 rng(777);
+
+static float randomFloat(float min, float max) {
+	return std::uniform_real_distribution<float>(min, max)(rng);
+}
+
+static glm::vec3 randomDirection() {
+	glm::vec3 v;
+	do {
+		v = glm::vec3(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1));
+	} while (glm::length(v) < 0.1f || glm::length(v) > 1.0f);
+	return glm::normalize(v);
+}
+
+static glm::vec3 position(const ir::Affine& m) {
+	return glm::vec3(m.m[0][3], m.m[1][3], m.m[2][3]);
+}
+
+//chainCount chains of jointCount joints, one root each, spaced along x.
+//Every bone is boneLength long and slightly bent, so no chain starts straight.
+struct Rig {
+	ir::Skeleton skeleton;
+	ir::FlatSkeleton flat;
+	std::vector<std::vector<int>> chains; // flat indices, root to tip
+
+	Rig(int chainCount, int jointCount, float boneLength) {
+		ir::SkeletonBuilder builder;
+		std::vector<std::vector<int>> built(chainCount);
+		for (int c = 0; c < chainCount; c++) {
+			ew::Transform root;
+			root.position = glm::vec3(4.0f * c, 0.0f, 0.0f);
+			int parent = builder.addJoint(nullptr, -1, root);
+			built[c].push_back(parent);
+			for (int j = 1; j < jointCount; j++) {
+				ew::Transform bone;
+				bone.position = glm::vec3(0.0f, boneLength, 0.0f);
+				bone.rotation = glm::angleAxis(0.2f, glm::normalize(glm::vec3(1.0f, 0.0f, 0.3f * j)));
+				parent = builder.addJoint(nullptr, parent, bone);
+				built[c].push_back(parent);
+			}
+		}
+		skeleton = builder.build();
+		flat = ir::flatten(skeleton);
+		ir::solveFK(flat);
+		for (const std::vector<int>& chain : built) {
+			chains.push_back(std::vector<int>());
+			for (int joint : chain) {
+				chains.back().push_back(flat.indexOf(skeleton.joints[joint]));
+			}
+		}
+	}
+
+	glm::vec3 jointPosition(int chain, int joint) const {
+		return position(flat.globalMats[chains[chain][joint]]);
+	}
+};
+
+//Only the joints IK rotates are dirty after solving
+static bool checkDirty(const ir::FlatSkeleton& flat, const std::vector<int>& chain) {
+	for (size_t j = 0; j < chain.size(); j++) {
+		bool expected = j + 1 < chain.size();
+		if (!CHECK((flat.dirty[chain[j]] != 0) == expected)) {
+			printf("  joint %d of %d\n", (int)j, (int)chain.size());
+			return false;
+		}
+	}
+	return true;
+}
+
+//Reachable targets are hit, unreachable ones leave the chain straight toward them
+static void testTwoBone(int chainCount) {
+	const float boneLength = 1.0f;
+	Rig rig(chainCount, 3, boneLength);
+	std::vector<ir::TwoBoneIK> chains(chainCount);
+	std::vector<bool> reachable(chainCount);
+	for (int c = 0; c < chainCount; c++) {
+		chains[c].root = rig.chains[c][0];
+		chains[c].mid = rig.chains[c][1];
+		chains[c].end = rig.chains[c][2];
+		//every third chain aims past its reach
+		reachable[c] = c % 3 != 2;
+		float distance = reachable[c] ? randomFloat(0.3f, 1.9f) : randomFloat(2.5f, 6.0f);
+		chains[c].target = rig.jointPosition(c, 0) + randomDirection() * distance;
+	}
+
+	ir::solveTwoBoneIK(rig.flat, chains.data(), chainCount);
+	for (int c = 0; c < chainCount; c++) {
+		if (!checkDirty(rig.flat, rig.chains[c])) {
+			printf("  two-bone chain %d of %d\n", c, chainCount);
+			return;
+		}
+	}
+	ir::solveFK(rig.flat);
+
+	for (int c = 0; c < chainCount; c++) {
+		const ir::TwoBoneIK& chain = chains[c];
+		glm::vec3 root = rig.jointPosition(c, 0);
+		glm::vec3 end = rig.jointPosition(c, 2);
+		bool ok = CHECK_NEAR(glm::length(end - chain.target), chain.error, 1e-3);
+		//bones keep their length
+		ok &= CHECK_NEAR(glm::length(rig.jointPosition(c, 1) - root), boneLength, 1e-4);
+		ok &= CHECK_NEAR(glm::length(end - rig.jointPosition(c, 1)), boneLength, 1e-4);
+		if (reachable[c]) {
+			ok &= CHECK(chain.error < 1e-3f);
+		}
+		else {
+			glm::vec3 toTarget = glm::normalize(chain.target - root);
+			ok &= CHECK(glm::length(end - (root + toTarget * 2.0f * boneLength)) < 1e-3f);
+			ok &= CHECK_NEAR(chain.error, glm::length(chain.target - root) - 2.0f * boneLength, 1e-3);
+		}
+		if (!ok) {
+			printf("  two-bone chain %d of %d, %s\n", c, chainCount, reachable[c] ? "reachable" : "out of reach");
+			return;
+		}
+	}
+}
+
+static void testFABRIK(int chainCount, int jointCount) {
+	const float boneLength = 0.5f;
+	const float reach = boneLength * (jointCount - 1);
+	Rig rig(chainCount, jointCount, boneLength);
+	std::vector<ir::FABRIKChain> chains(chainCount);
+	std::vector<bool> reachable(chainCount);
+	for (int c = 0; c < chainCount; c++) {
+		chains[c].joints = rig.chains[c].data();
+		chains[c].jointCount = jointCount;
+		reachable[c] = c % 3 != 2;
+		float distance = reachable[c] ? randomFloat(0.2f, 0.8f) * reach : randomFloat(1.2f, 2.0f) * reach;
+		chains[c].target = rig.jointPosition(c, 0) + randomDirection() * distance;
+	}
+
+	CHECK(ir::solveFABRIK(rig.flat, chains.data(), chainCount));
+	for (int c = 0; c < chainCount; c++) {
+		if (!checkDirty(rig.flat, rig.chains[c])) {
+			printf("  FABRIK chain %d of %d\n", c, chainCount);
+			return;
+		}
+	}
+	ir::solveFK(rig.flat);
+
+	for (int c = 0; c < chainCount; c++) {
+		const ir::FABRIKChain& chain = chains[c];
+		glm::vec3 root = rig.jointPosition(c, 0);
+		glm::vec3 tip = rig.jointPosition(c, jointCount - 1);
+		bool ok = CHECK_NEAR(glm::length(tip - chain.target), chain.error, 1e-3);
+		if (reachable[c]) {
+			ok &= CHECK(chain.iterations >= 1 && chain.iterations <= ir::FABRIK_MAX_ITERATIONS);
+			//stopping early means the tolerance was met
+			if (chain.iterations < ir::FABRIK_MAX_ITERATIONS) {
+				ok &= CHECK(chain.error <= ir::FABRIK_TOLERANCE);
+			}
+		}
+		else {
+			ok &= CHECK(chain.iterations == 0);
+			glm::vec3 toTarget = glm::normalize(chain.target - root);
+			for (int j = 1; j < jointCount; j++) {
+				ok &= CHECK(glm::length(rig.jointPosition(c, j) - (root + toTarget * (boneLength * j))) < 1e-3f);
+			}
+			ok &= CHECK_NEAR(chain.error, glm::length(chain.target - root) - reach, 1e-3);
+		}
+		if (!ok) {
+			printf("  FABRIK chain %d of %d, %d joints, %s\n", c, chainCount, jointCount, reachable[c] ? "reachable" : "out of reach");
+			return;
+		}
+	}
+}
+
+//A target already within tolerance takes no iterations, and invalid chains are reported and skipped
+static void testFABRIKEdgeCases() {
+	Rig rig(2, 4, 0.5f);
+	ir::FABRIKChain chains[2];
+	chains[0].joints = rig.chains[0].data();
+	chains[0].jointCount = 4;
+	chains[0].target = rig.jointPosition(0, 3);
+	chains[1].joints = rig.chains[1].data();
+	chains[1].jointCount = 1;
+	chains[1].target = glm::vec3(100.0f);
+
+	CHECK(!ir::solveFABRIK(rig.flat, chains, 2));
+	CHECK(chains[0].iterations == 0);
+	CHECK(chains[0].error <= ir::FABRIK_TOLERANCE);
+	CHECK(chains[1].iterations == 0);
+	//nothing moved, so nothing in the invalid chain is dirty
+	for (int joint : rig.chains[1]) {
+		CHECK(!rig.flat.dirty[joint]);
+	}
+}
+
+int main() {
+	//whole registers, a partial one, and both
+	const int counts[] = { 1, ir::simd::WIDTH, ir::simd::WIDTH + 3, 3 * ir::simd::WIDTH - 1 };
+	for (int count : counts) {
+		testTwoBone(count);
+		testFABRIK(count, 2);
+		testFABRIK(count, 5);
+		testFABRIK(count, ir::FABRIK_MAX_JOINTS);
+	}
+	testFABRIKEdgeCases();
+	return test::testResult();
+}
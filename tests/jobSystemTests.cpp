@@ -0,0 +1,139 @@
+#include <ew/jobSystem.h>
+#include "test.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//Every index of [0, count) is visited exactly once, whatever the batch size
+static void testParallelForCoverage(ew::JobSystem& jobs) {
+	const int counts[] = { 0, 1, 7, 64, 1000, 4099 };
+	const int batchSizes[] = { 0, 1, 3, 64, 5000 };
+	for (int count : counts) {
+		for (int batchSize : batchSizes) {
+			std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[count + 1]);
+			for (int i = 0; i < count; i++) {
+				visits[i] = 0;
+			}
+			std::atomic<int> badRanges{ 0 };
+			ew::JobHandle handle = jobs.parallelFor(count, batchSize, [&](int begin, int end) {
+				if (begin < 0 || end > count || begin >= end) {
+					badRanges++;
+				}
+				for (int i = begin; i < end; i++) {
+					visits[i]++;
+				}
+			});
+			jobs.wait(handle);
+			CHECK(jobs.isDone(handle));
+			CHECK(badRanges == 0);
+			int wrong = 0;
+			for (int i = 0; i < count; i++) {
+				wrong += visits[i] != 1;
+			}
+			if (!CHECK(wrong == 0)) {
+				printf("  count %d, batch size %d\n", count, batchSize);
+			}
+		}
+	}
+}
+
+//A job only starts once its dependency has completed, including whole parallelFors
+static void testDependencies(ew::JobSystem& jobs) {
+	std::atomic<bool> firstDone{ false };
+	std::atomic<bool> ranEarly{ false };
+	ew::JobHandle first = jobs.schedule([&]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		firstDone = true;
+	});
+	ew::JobHandle second = jobs.schedule([&]() {
+		if (!firstDone) {
+			ranEarly = true;
+		}
+	}, first);
+	jobs.wait(second);
+	CHECK(firstDone);
+	CHECK(!ranEarly);
+
+	//Second pass reads everything the first pass wrote
+	const int count = 10000;
+	std::vector<int> values(count, 0);
+	std::vector<int> doubled(count, 0);
+	ew::JobHandle fill = jobs.parallelFor(count, 100, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			values[i] = i;
+		}
+	});
+	ew::JobHandle twice = jobs.parallelFor(count, 77, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			doubled[i] = values[i] * 2;
+		}
+	}, fill);
+	jobs.wait(twice);
+	CHECK(jobs.isDone(fill));
+	int wrong = 0;
+	for (int i = 0; i < count; i++) {
+		wrong += doubled[i] != i * 2;
+	}
+	CHECK(wrong == 0);
+
+	//Depending on a handle that has already finished runs right away
+	ew::JobHandle late = jobs.schedule([&]() { firstDone = false; }, first);
+	jobs.wait(late);
+	CHECK(!firstDone);
+}
+
+//Waiting on finished or empty handles returns instead of blocking
+static void testWaitOnFinished(ew::JobSystem& jobs) {
+	std::atomic<int> runs{ 0 };
+	ew::JobHandle handle = jobs.schedule([&]() { runs++; });
+	jobs.wait(handle);
+	jobs.wait(handle);
+	jobs.wait(nullptr);
+	CHECK(runs == 1);
+	CHECK(jobs.isDone(handle));
+	CHECK(jobs.isDone(nullptr));
+	CHECK(jobs.isDone(jobs.parallelFor(0, 1, [](int, int) {})));
+	jobs.waitAll();
+}
+
+//Jobs that schedule and wait on more jobs, which must not deadlock even with one worker
+static void testNestedJobs(ew::JobSystem& jobs) {
+	const int outer = 16;
+	const int inner = 500;
+	std::atomic<int> total{ 0 };
+	ew::JobHandle handle = jobs.parallelFor(outer, 1, [&](int begin, int end) {
+		for (int o = begin; o < end; o++) {
+			ew::JobHandle nested = jobs.parallelFor(inner, 10, [&](int innerBegin, int innerEnd) {
+				total += innerEnd - innerBegin;
+			});
+			jobs.wait(nested);
+		}
+	});
+	jobs.wait(handle);
+	CHECK(total == outer * inner);
+
+	//Continuations scheduled from inside a job
+	std::atomic<int> order{ 0 };
+	std::atomic<int> secondSaw{ -1 };
+	ew::JobHandle done = jobs.schedule([&]() {
+		ew::JobHandle a = jobs.schedule([&]() { order = 1; });
+		ew::JobHandle b = jobs.schedule([&]() { secondSaw = order.load(); }, a);
+		jobs.wait(b);
+	});
+	jobs.wait(done);
+	CHECK(secondSaw == 1);
+}
+
+int main() {
+	const unsigned int workerCounts[] = { 1, 3, 0 };
+	for (unsigned int workers : workerCounts) {
+		ew::JobSystem jobs(workers);
+		testParallelForCoverage(jobs);
+		testDependencies(jobs);
+		testWaitOnFinished(jobs);
+		testNestedJobs(jobs);
+	}
+	return test::testResult();
+}
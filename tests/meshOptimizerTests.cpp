@@ -0,0 +1,159 @@
+#include <ew/meshOptimizer.h>
+#include <ew/procGen.h>
+#include "test.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+//ACMR on hand-counted orders, and optimizeMesh keeping the mesh intact and deterministic
+
+typedef std::array<int, 3> Triangle;
+
+//Each vertex remembers its original index in uv.x, and skinned meshes in their bone indices too
+static void tagVertices(ew::MeshData& meshData, bool skinned) {
+	meshData.skinWeights.clear();
+	for (size_t v = 0; v < meshData.vertices.size(); v++) {
+		meshData.vertices[v].uv = glm::vec2((float)v, 0.0f);
+		if (skinned) {
+			ew::SkinWeights skin;
+			skin.bones = glm::ivec4((int)v, (int)v % 7, 3, (int)v / 2);
+			skin.weights = glm::vec4(0.5f, 0.25f, 0.125f, 0.125f);
+			meshData.skinWeights.push_back(skin);
+		}
+	}
+}
+
+//Triangles as original vertex indices, rotated to start at the smallest so winding is kept
+static std::vector<Triangle> originalTriangles(const ew::MeshData& meshData) {
+	std::vector<Triangle> triangles;
+	for (size_t i = 0; i + 2 < meshData.indices.size(); i += 3) {
+		Triangle t;
+		for (int k = 0; k < 3; k++) {
+			t[k] = (int)meshData.vertices[meshData.indices[i + k]].uv.x;
+		}
+		std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+		triangles.push_back(t);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+static void shuffleTriangles(std::vector<unsigned int>& indices, unsigned int seed) {
+	std::vector<Triangle> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		triangles.push_back({ (int)indices[i], (int)indices[i + 1], (int)indices[i + 2] });
+	}
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+	for (size_t t = 0; t < triangles.size(); t++) {
+		for (int k = 0; k < 3; k++) {
+			indices[t * 3 + k] = (unsigned int)triangles[t][k];
+		}
+	}
+}
+
+static void testKnownACMR() {
+	CHECK(ew::computeACMR({}, 0) == 0.0f);
+	//Every vertex of the first triangle misses
+	CHECK(ew::computeACMR({ 0, 1, 2 }, 3) == 3.0f);
+	//A quad as two triangles sharing an edge, 4 misses
+	CHECK(ew::computeACMR({ 0, 1, 2, 2, 1, 3 }, 4) == 2.0f);
+	//The same triangle again is free
+	CHECK(ew::computeACMR({ 0, 1, 2, 0, 1, 2 }, 3) == 1.5f);
+	//A fan around vertex 0: 3 misses, then 1 per triangle
+	CHECK(ew::computeACMR({ 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 5 }, 6) == 6.0f / 4);
+	//FIFO eviction: with room for 3 vertices the first triangle is gone when it comes back, with 6 it is not
+	std::vector<unsigned int> evicting = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+	CHECK(ew::computeACMR(evicting, 6, 3) == 3.0f);
+	CHECK(ew::computeACMR(evicting, 6, 6) == 2.0f);
+	//A hit doesn't refresh a vertex's place in a FIFO cache, so 0 is evicted by 4 (LRU would give 5 / 3)
+	std::vector<unsigned int> fifo = { 0, 1, 2, 3, 0, 4, 0, 2, 3 };
+	CHECK(ew::computeACMR(fifo, 5, 4) == 2.0f);
+}
+
+//Same triangles with the same winding after every pass, and vertices renumbered in first use order
+static void testPreservesTriangles(ew::MeshData meshData, const char* name) {
+	shuffleTriangles(meshData.indices, 7);
+	tagVertices(meshData, true);
+	//Vertices no triangle uses get dropped
+	meshData.vertices.push_back(meshData.vertices[0]);
+	meshData.vertices.back().uv.x = -1;
+	meshData.skinWeights.push_back(ew::SkinWeights());
+	std::vector<Triangle> before = originalTriangles(meshData);
+
+	ew::MeshData optimized = meshData;
+	ew::MeshOptimizeReport report = ew::optimizeMesh(optimized);
+	if (!CHECK(originalTriangles(optimized) == before)) {
+		printf("  %s\n", name);
+	}
+	CHECK(optimized.indices.size() == meshData.indices.size());
+	std::vector<bool> used(meshData.vertices.size(), false);
+	for (unsigned int index : meshData.indices) {
+		used[index] = true;
+	}
+	CHECK(optimized.vertices.size() == (size_t)std::count(used.begin(), used.end(), true));
+	CHECK(optimized.skinWeights.size() == optimized.vertices.size());
+	unsigned int nextNew = 0;
+	for (unsigned int index : optimized.indices) {
+		CHECK(index <= nextNew);
+		nextNew = std::max(nextNew, index + 1);
+	}
+	CHECK(report.acmrBefore == ew::computeACMR(meshData.indices, (int)meshData.vertices.size()));
+	CHECK(report.acmrAfter == ew::computeACMR(optimized.indices, (int)optimized.vertices.size()));
+	//Shuffled grids leave a lot to gain, a cube's faces share no vertices and can only stay the same
+	bool improved = (optimized.indices.size() > 100) ? report.acmrAfter < report.acmrBefore : report.acmrAfter <= report.acmrBefore;
+	if (!CHECK(improved)) {
+		printf("  %s: ACMR %g -> %g\n", name, report.acmrBefore, report.acmrAfter);
+	}
+}
+
+//Vertex fetch moves skin weights with their vertices, and leaves unskinned meshes unskinned
+static void testVertexFetchKeepsWeights() {
+	ew::MeshData meshData = ew::createSphere(1.0f, 12);
+	shuffleTriangles(meshData.indices, 3);
+	tagVertices(meshData, true);
+	std::vector<ew::Vertex> original = meshData.vertices;
+	ew::optimizeVertexFetch(meshData);
+	int unpaired = 0;
+	for (size_t v = 0; v < meshData.vertices.size(); v++) {
+		int source = (int)meshData.vertices[v].uv.x;
+		const ew::SkinWeights& skin = meshData.skinWeights[v];
+		unpaired += skin.bones != glm::ivec4(source, source % 7, 3, source / 2);
+		unpaired += meshData.vertices[v].pos != original[source].pos;
+	}
+	CHECK(unpaired == 0);
+
+	ew::MeshData unskinned = ew::createSphere(1.0f, 12);
+	ew::optimizeVertexFetch(unskinned);
+	CHECK(unskinned.skinWeights.empty());
+}
+
+//Bitwise the same output from the same input
+static void testDeterministic() {
+	ew::MeshData meshData = ew::createSphere(1.0f, 24);
+	shuffleTriangles(meshData.indices, 11);
+	tagVertices(meshData, true);
+	ew::MeshData first = meshData;
+	ew::MeshData second = meshData;
+	ew::MeshOptimizeReport firstReport = ew::optimizeMesh(first);
+	ew::MeshOptimizeReport secondReport = ew::optimizeMesh(second);
+	CHECK(first.indices == second.indices);
+	CHECK(first.vertices.size() == second.vertices.size());
+	bool sameVertices = true;
+	for (size_t v = 0; v < first.vertices.size() && v < second.vertices.size(); v++) {
+		sameVertices &= first.vertices[v].uv == second.vertices[v].uv;
+		sameVertices &= first.skinWeights[v].bones == second.skinWeights[v].bones;
+	}
+	CHECK(sameVertices);
+	CHECK(firstReport.acmrBefore == secondReport.acmrBefore && firstReport.acmrAfter == secondReport.acmrAfter);
+}
+
+int main() {
+	testKnownACMR();
+	testPreservesTriangles(ew::createPlane(1.0f, 1.0f, 32), "plane");
+	testPreservesTriangles(ew::createSphere(1.0f, 32), "sphere");
+	testPreservesTriangles(ew::createCylinder(1.0f, 2.0f, 48), "cylinder");
+	testPreservesTriangles(ew::createCube(1.0f), "cube");
+	testVertexFetchKeepsWeights();
+	testDeterministic();
+	return test::testResult();
+}
@@ -0,0 +1,281 @@
+#include <ew/sceneGraph.h>
+#include "test.h"
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+//SceneGraph against a plain parent map solved recursively with parent * local
+
+static std::mt19937 rng(2024);
+
+static float randomFloat(float min, float max) {
+	return std::uniform_real_distribution<float>(min, max)(rng);
+}
+
+static ew::Transform randomLocal() {
+	ew::Transform local;
+	local.position = glm::vec3(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1));
+	local.rotation = glm::normalize(glm::quat(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1)));
+	local.scale = glm::vec3(randomFloat(0.8f, 1.2f), randomFloat(0.8f, 1.2f), randomFloat(0.8f, 1.2f));
+	return local;
+}
+
+//What the graph should hold, kept with naive containers
+struct Reference {
+	std::map<ew::NodeId, ew::NodeId> parents;
+	std::map<ew::NodeId, ew::Transform> locals;
+
+	glm::mat4 world(ew::NodeId node) const {
+		glm::mat4 local = locals.at(node).modelMatrix();
+		ew::NodeId parent = parents.at(node);
+		return parent == ew::NULL_NODE ? local : world(parent) * local;
+	}
+
+	bool isDescendant(ew::NodeId node, ew::NodeId ancestor) const {
+		for (ew::NodeId p = node; p != ew::NULL_NODE; p = parents.at(p)) {
+			if (p == ancestor) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//node and everything under it
+	std::vector<ew::NodeId> subtree(ew::NodeId node) const {
+		std::vector<ew::NodeId> nodes;
+		for (const auto& entry : parents) {
+			if (isDescendant(entry.first, node)) {
+				nodes.push_back(entry.first);
+			}
+		}
+		return nodes;
+	}
+
+	ew::NodeId randomNode() const {
+		auto it = parents.begin();
+		std::advance(it, rng() % parents.size());
+		return it->first;
+	}
+};
+
+static ew::NodeId create(ew::SceneGraph& graph, Reference& reference, ew::NodeId parent) {
+	ew::Transform local = randomLocal();
+	ew::NodeId node = graph.create(parent, local);
+	reference.parents[node] = parent;
+	reference.locals[node] = local;
+	return node;
+}
+
+static void destroy(ew::SceneGraph& graph, Reference& reference, ew::NodeId node) {
+	for (ew::NodeId n : reference.subtree(node)) {
+		reference.parents.erase(n);
+		reference.locals.erase(n);
+	}
+	graph.destroy(node);
+}
+
+//Every live node has the reference's parent, local and world matrix, and storage is depth first
+static bool matchesReference(const ew::SceneGraph& graph, const Reference& reference) {
+	if (!CHECK(graph.getNumNodes() == (int)reference.parents.size())) {
+		return false;
+	}
+	std::map<ew::NodeId, int> slots;
+	for (int slot = 0; slot < graph.getNumNodes(); slot++) {
+		slots[graph.getNodeAt(slot)] = slot;
+	}
+	for (const auto& entry : reference.parents) {
+		ew::NodeId node = entry.first;
+		bool ok = CHECK(graph.isValid(node)) && CHECK(graph.getParent(node) == entry.second);
+		ok = ok && CHECK(slots.count(node) == 1);
+		if (ok && entry.second != ew::NULL_NODE) {
+			ok = CHECK(slots[entry.second] < slots[node]);
+		}
+		if (ok) {
+			glm::mat4 expected = reference.world(node);
+			const glm::mat4& actual = graph.getWorldMatrix(node);
+			for (int c = 0; c < 4 && ok; c++) {
+				for (int r = 0; r < 4 && ok; r++) {
+					ok = CHECK_NEAR(actual[c][r], expected[c][r], 1e-4 * (1.0 + std::fabs(expected[c][r])));
+				}
+			}
+		}
+		if (!ok) {
+			printf("  node %d\n", node);
+			return false;
+		}
+	}
+	return true;
+}
+
+//Random creates, destroys, reparents (cycles included) and edits, checked after every update
+static void testRandomEdits() {
+	ew::SceneGraph graph;
+	Reference reference;
+	for (int i = 0; i < 100; i++) {
+		create(graph, reference, (i == 0 || rng() % 10 == 0) ? ew::NULL_NODE : reference.randomNode());
+	}
+	graph.update();
+	if (!matchesReference(graph, reference)) {
+		return;
+	}
+
+	for (int frame = 0; frame < 200; frame++) {
+		int edits = 1 + rng() % 4;
+		for (int e = 0; e < edits; e++) {
+			int op = rng() % 5;
+			if (reference.parents.empty()) {
+				op = 0;
+			}
+			if (op == 0) {
+				create(graph, reference, (reference.parents.empty() || rng() % 5 == 0) ? ew::NULL_NODE : reference.randomNode());
+			}
+			else if (op == 1 && reference.parents.size() > 50) {
+				destroy(graph, reference, reference.randomNode());
+			}
+			else if (op == 2) {
+				ew::NodeId node = reference.randomNode();
+				ew::NodeId parent = (rng() % 4 == 0) ? ew::NULL_NODE : reference.randomNode();
+				bool cycle = parent != ew::NULL_NODE && reference.isDescendant(parent, node);
+				if (!CHECK(graph.setParent(node, parent) == !cycle)) {
+					printf("  setParent(%d, %d), frame %d\n", node, parent, frame);
+					return;
+				}
+				if (!cycle) {
+					reference.parents[node] = parent;
+				}
+			}
+			else {
+				ew::NodeId node = reference.randomNode();
+				ew::Transform local = randomLocal();
+				if (op == 3) {
+					graph.setLocal(node, local);
+				}
+				else {
+					graph.editLocal(node) = local;
+				}
+				reference.locals[node] = local;
+			}
+		}
+		graph.update();
+		if (!matchesReference(graph, reference)) {
+			printf("  frame %d\n", frame);
+			return;
+		}
+	}
+}
+
+//A node can't be moved under itself or its own descendants, and a refused move changes nothing
+static void testCycleRejected() {
+	ew::SceneGraph graph;
+	Reference reference;
+	ew::NodeId a = create(graph, reference, ew::NULL_NODE);
+	ew::NodeId b = create(graph, reference, a);
+	ew::NodeId c = create(graph, reference, b);
+	graph.update();
+	CHECK(!graph.setParent(a, a));
+	CHECK(!graph.setParent(a, c));
+	CHECK(!graph.setParent(b, c));
+	graph.update();
+	CHECK(graph.getNumRecomputed() == 0);
+	matchesReference(graph, reference);
+	//moving a leaf up is fine
+	CHECK(graph.setParent(c, a));
+	reference.parents[c] = a;
+	graph.update();
+	matchesReference(graph, reference);
+}
+
+//Destroyed ids come back from create(), with no trace of the old node
+static void testIdReuse() {
+	ew::SceneGraph graph;
+	Reference reference;
+	ew::NodeId root = create(graph, reference, ew::NULL_NODE);
+	ew::NodeId branch = create(graph, reference, root);
+	for (int i = 0; i < 5; i++) {
+		create(graph, reference, i < 3 ? branch : root);
+	}
+	graph.update();
+	std::vector<ew::NodeId> destroyed = reference.subtree(branch);
+	CHECK(destroyed.size() == 4);
+	destroy(graph, reference, branch);
+	for (ew::NodeId node : destroyed) {
+		CHECK(!graph.isValid(node));
+	}
+	graph.update();
+	if (!matchesReference(graph, reference)) {
+		return;
+	}
+
+	std::set<ew::NodeId> freed(destroyed.begin(), destroyed.end());
+	std::set<ew::NodeId> reused;
+	ew::NodeId parent = ew::NULL_NODE;
+	for (size_t i = 0; i < destroyed.size(); i++) {
+		parent = create(graph, reference, parent);
+		reused.insert(parent);
+	}
+	CHECK(reused == freed);
+	//the next one is new
+	ew::NodeId fresh = create(graph, reference, root);
+	CHECK(freed.count(fresh) == 0);
+	graph.update();
+	matchesReference(graph, reference);
+}
+
+//update() recomputes exactly the subtrees under changed nodes
+static void testSubtreeUpdate() {
+	ew::SceneGraph graph;
+	Reference reference;
+	for (int i = 0; i < 300; i++) {
+		create(graph, reference, i == 0 ? ew::NULL_NODE : reference.randomNode());
+	}
+	graph.update();
+	CHECK(graph.getNumRecomputed() == 300);
+	graph.update();
+	CHECK(graph.getNumRecomputed() == 0);
+
+	for (int i = 0; i < 50; i++) {
+		ew::NodeId node = reference.randomNode();
+		ew::NodeId other = reference.randomNode();
+		graph.editLocal(node).position.x += 0.5f;
+		reference.locals[node].position.x += 0.5f;
+		size_t expected = reference.subtree(node).size();
+		if (i % 2 == 1) {
+			//a second edit counts once if it is inside the first subtree, and adds its own otherwise
+			graph.editLocal(other).scale *= 1.01f;
+			reference.locals[other].scale *= 1.01f;
+			if (reference.isDescendant(node, other)) {
+				expected = reference.subtree(other).size();
+			}
+			else if (!reference.isDescendant(other, node)) {
+				expected += reference.subtree(other).size();
+			}
+		}
+		graph.update();
+		bool ok = CHECK(graph.getNumRecomputed() == (int)expected);
+		ok &= matchesReference(graph, reference);
+		if (!ok) {
+			printf("  edit %d, node %d\n", i, node);
+			return;
+		}
+	}
+
+	//reparenting recomputes the moved subtree
+	ew::NodeId node = reference.randomNode();
+	ew::NodeId root = graph.getNodeAt(0);
+	if (!reference.isDescendant(root, node)) {
+		CHECK(graph.setParent(node, root));
+		reference.parents[node] = root;
+		graph.update();
+		CHECK(graph.getNumRecomputed() == (int)reference.subtree(node).size());
+		matchesReference(graph, reference);
+	}
+}
+
+int main() {
+	testRandomEdits();
+	testCycleRejected();
+	testIdReuse();
+	testSubtreeUpdate();
+	return test::testResult();
+}
@@ -0,0 +1,269 @@
+#include <ew/external/glad.h>
+#include <ew/mesh.h>
+#include <ew/shader.h>
+#include <ew/skinPalette.h>
+#include <ew/transform.h>
+#include <ir/skinning.h>
+#include <GLFW/glfw3.h>
+#include "test.h"
+
+//skinned.vert driven through ew::Mesh and ew::SkinPalette on a hidden window, with the
+//transformed vertices captured by transform feedback and compared to ir::skinVertices.
+//Checks the std430 palette layout, _PaletteOffset indexing and the integer bone indices
+//at attribute 3 / weights at attribute 4. Skipped where no GL 4.5 context can be made.
+
+#ifndef SKINNED_VERT_PATH
+#define SKINNED_VERT_PATH "assets/skinned.vert"
+#endif
+
+//Values captured per vertex, in the order of CAPTURED_VARYINGS
+struct CapturedVertex {
+	glm::vec4 clipPos;
+	glm::vec3 worldPos;
+	glm::vec3 worldNormal;
+};
+static const char* CAPTURED_VARYINGS[] = { "gl_Position", "Surface.WorldPos", "Surface.WorldNormal" };
+
+static GLFWwindow* initHiddenWindow() {
+	if (!glfwInit()) {
+		return nullptr;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "skinningShaderTests", NULL, NULL);
+	if (window == NULL) {
+		return nullptr;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGL(glfwGetProcAddress)) {
+		glfwDestroyWindow(window);
+		return nullptr;
+	}
+	return window;
+}
+
+//Vertex shader only, linked with its outputs captured and no rasterization needed
+static unsigned int createCaptureProgram(const std::string& source) {
+	const char* sourceCode = source.c_str();
+	unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &sourceCode, NULL);
+	glCompileShader(vertexShader);
+	int success;
+	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+	if (!CHECK(success)) {
+		char infoLog[512];
+		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+		printf("  %s\n", infoLog);
+	}
+	unsigned int program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glTransformFeedbackVaryings(program, 3, CAPTURED_VARYINGS, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(program);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!CHECK(success)) {
+		char infoLog[512];
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
+		printf("  %s\n", infoLog);
+	}
+	glDeleteShader(vertexShader);
+	return program;
+}
+
+static ew::Vertex makeVertex(glm::vec3 pos, glm::vec3 normal) {
+	ew::Vertex vertex;
+	vertex.pos = pos;
+	vertex.normal = glm::normalize(normal);
+	vertex.uv = glm::vec2(pos.x, pos.y);
+	return vertex;
+}
+
+static ew::SkinWeights makeWeights(glm::ivec4 bones, glm::vec4 weights) {
+	ew::SkinWeights skin;
+	skin.bones = bones;
+	skin.weights = weights;
+	return skin;
+}
+
+//Triangles covering one bone, blends of two and four bones, bone indices past 3 and a vertex without weights
+static ew::MeshData makeSkinnedMesh() {
+	ew::MeshData meshData;
+	meshData.vertices = {
+		makeVertex(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0, 0, 1)),
+		makeVertex(glm::vec3(1.0f, 0.2f, 0.0f), glm::vec3(0, 1, 1)),
+		makeVertex(glm::vec3(0.5f, 1.5f, -0.3f), glm::vec3(1, 0, 0)),
+		makeVertex(glm::vec3(-0.7f, 2.5f, 0.4f), glm::vec3(-1, 1, 0)),
+		makeVertex(glm::vec3(0.2f, 3.1f, 0.9f), glm::vec3(0, 0, -1)),
+		makeVertex(glm::vec3(1.3f, -0.6f, 0.1f), glm::vec3(1, 1, 1)),
+		makeVertex(glm::vec3(-1.1f, 0.8f, -1.2f), glm::vec3(0, -1, 0.5f)),
+	};
+	meshData.skinWeights = {
+		makeWeights(glm::ivec4(0, 0, 0, 0), glm::vec4(1.0f, 0.0f, 0.0f, 0.0f)),
+		makeWeights(glm::ivec4(1, 0, 0, 0), glm::vec4(1.0f, 0.0f, 0.0f, 0.0f)),
+		makeWeights(glm::ivec4(1, 2, 0, 0), glm::vec4(0.6f, 0.4f, 0.0f, 0.0f)),
+		makeWeights(glm::ivec4(3, 2, 1, 0), glm::vec4(0.1f, 0.2f, 0.3f, 0.4f)),
+		makeWeights(glm::ivec4(4, 0, 0, 0), glm::vec4(1.0f, 0.0f, 0.0f, 0.0f)),
+		makeWeights(glm::ivec4(0, 0, 0, 0), glm::vec4(0.0f)),
+		makeWeights(glm::ivec4(0, 4, 3, 0), glm::vec4(0.0f, 0.5f, 0.5f, 0.0f)),
+	};
+	meshData.indices = { 0, 1, 2, 2, 3, 4, 5, 6, 3, 4, 1, 6 };
+	return meshData;
+}
+
+//A chain of joints posed away from its bind pose, and bones listed in a different order than the joints
+struct Rig {
+	ir::Skeleton skeleton;
+	ir::FlatSkeleton flat;
+	ir::SkinBinding binding;
+};
+
+static void makeRig(Rig& rig) {
+	const char* names[] = { "hips", "spine", "chest", "neck", "head" };
+	ir::SkeletonBuilder builder;
+	for (int i = 0; i < 5; i++) {
+		ew::Transform bind;
+		bind.position = glm::vec3(0.0f, i == 0 ? 0.0f : 0.8f, 0.0f);
+		builder.addJoint(names[i], i - 1, bind);
+	}
+	rig.skeleton = builder.build();
+	rig.flat = ir::flatten(rig.skeleton);
+	ir::solveFK(rig.flat);
+
+	const int boneJoints[] = { 0, 2, 1, 4, 3 };
+	std::vector<ew::Bone> bones;
+	for (int joint : boneJoints) {
+		ew::Bone bone;
+		bone.name = names[joint];
+		bone.offset = ir::toMat4(ir::inverse(rig.flat.globalMats[joint]));
+		bones.push_back(bone);
+	}
+	rig.binding = ir::bindSkin(bones, rig.flat);
+}
+
+static void pose(Rig& rig, float angle) {
+	for (int i = 0; i < rig.flat.size(); i++) {
+		rig.flat.localPoses[i].rotation = glm::angleAxis(angle * (i + 1), glm::normalize(glm::vec3(0.3f, 0.2f * i, 1.0f)));
+		rig.flat.localPoses[i].scale = glm::vec3(1.0f + 0.1f * i);
+		rig.flat.markDirty(i);
+	}
+	ir::solveFK(rig.flat);
+}
+
+//Draws the mesh with the palette at offset and compares every captured vertex to the CPU skinned one
+static void checkInstance(unsigned int program, const ew::Mesh& mesh, const ew::MeshData& meshData, const glm::mat4* palette, int offset,
+	const glm::mat4& model, const glm::mat4& viewProjection) {
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "_PaletteOffset"), offset);
+	glUniformMatrix4fv(glGetUniformLocation(program, "_Model"), 1, GL_FALSE, &model[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(program, "_ViewProjection"), 1, GL_FALSE, &viewProjection[0][0]);
+
+	int numCaptured = (int)meshData.indices.size();
+	unsigned int feedbackBuffer;
+	glGenBuffers(1, &feedbackBuffer);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedbackBuffer);
+	glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, sizeof(CapturedVertex) * numCaptured, NULL, GL_STATIC_READ);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedbackBuffer);
+
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBeginTransformFeedback(GL_TRIANGLES);
+	mesh.draw();
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	std::vector<CapturedVertex> captured(numCaptured);
+	glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, sizeof(CapturedVertex) * numCaptured, captured.data());
+	glDeleteBuffers(1, &feedbackBuffer);
+	CHECK(glGetError() == GL_NO_ERROR);
+
+	std::vector<ew::Vertex> skinned(meshData.vertices.size());
+	ir::skinVertices(meshData.vertices.data(), meshData.skinWeights.data(), palette, skinned.data(), 0, (int)skinned.size());
+
+	//Triangles are captured vertex by vertex in index order
+	for (int i = 0; i < numCaptured; i++) {
+		unsigned int v = meshData.indices[i];
+		glm::vec3 worldPos = glm::vec3(model * glm::vec4(skinned[v].pos, 1.0f));
+		glm::vec4 clipPos = viewProjection * glm::vec4(worldPos, 1.0f);
+		bool same = true;
+		for (int c = 0; c < 3; c++) {
+			same &= CHECK_NEAR(captured[i].worldPos[c], worldPos[c], 1e-4 * (1.0 + std::fabs(worldPos[c])));
+		}
+		for (int c = 0; c < 4; c++) {
+			same &= CHECK_NEAR(captured[i].clipPos[c], clipPos[c], 1e-4 * (1.0 + std::fabs(clipPos[c])));
+		}
+		//The shader's normal matrix only matches the CPU's blended normal for rigid, single bone vertices
+		const glm::vec4& weights = meshData.skinWeights[v].weights;
+		int influences = (weights.x != 0) + (weights.y != 0) + (weights.z != 0) + (weights.w != 0);
+		if (influences <= 1) {
+			glm::vec3 worldNormal = glm::normalize(glm::mat3(model) * skinned[v].normal);
+			glm::vec3 capturedNormal = glm::normalize(captured[i].worldNormal);
+			for (int c = 0; c < 3; c++) {
+				same &= CHECK_NEAR(capturedNormal[c], worldNormal[c], 1e-4);
+			}
+		}
+		if (!same) {
+			printf("  vertex %u, palette offset %d\n", v, offset);
+			return;
+		}
+	}
+}
+
+int main() {
+	GLFWwindow* window = initHiddenWindow();
+	if (window == nullptr) {
+		printf("No OpenGL 4.5 context, skipping\n");
+		glfwTerminate();
+		return TEST_SKIPPED;
+	}
+	{
+		std::string source = ew::loadShaderSourceFromFile(SKINNED_VERT_PATH);
+		if (!CHECK(!source.empty())) {
+			return test::testResult();
+		}
+		unsigned int program = createCaptureProgram(source);
+
+		ew::MeshData meshData = makeSkinnedMesh();
+		ew::Mesh mesh(meshData);
+		CHECK(mesh.isSkinned());
+
+		//Two instances in different poses share one palette, the second one starts past the first
+		Rig rig;
+		makeRig(rig);
+		ew::SkinPalette gpuPalette;
+		pose(rig, 0.4f);
+		int first = ir::addSkinPalette(gpuPalette, rig.binding, rig.flat.globalMats.data());
+		pose(rig, -0.9f);
+		int second = ir::addSkinPalette(gpuPalette, rig.binding, rig.flat.globalMats.data());
+		CHECK(first == 0 && second == rig.binding.size());
+		gpuPalette.upload();
+
+		ew::Transform transform;
+		transform.position = glm::vec3(1.0f, -2.0f, 0.5f);
+		transform.rotation = glm::angleAxis(0.7f, glm::normalize(glm::vec3(1, 1, 0)));
+		transform.scale = glm::vec3(1.5f);
+		glm::mat4 model = transform.modelMatrix();
+		//Any projective matrix will do, w differs per vertex
+		glm::mat4 viewProjection(
+			glm::vec4(1.2f, 0.0f, 0.1f, 0.0f),
+			glm::vec4(0.0f, 1.7f, -0.2f, 0.0f),
+			glm::vec4(0.3f, 0.0f, -1.0f, -1.0f),
+			glm::vec4(0.5f, -0.4f, -0.2f, 4.0f));
+
+		const glm::mat4* palette = gpuPalette.data();
+		checkInstance(program, mesh, meshData, palette + first, first, model, viewProjection);
+		checkInstance(program, mesh, meshData, palette + second, second, model, viewProjection);
+
+		//skinned.vert reads FLOAT vertices, a packed format asked for a skinned mesh is ignored
+		const ew::VertexFormat packedFormats[] = { ew::VertexFormat::PACKED, ew::VertexFormat::QUANTIZED };
+		for (ew::VertexFormat format : packedFormats) {
+			ew::Mesh packedMesh(meshData, format);
+			if (CHECK(packedMesh.getVertexFormat() == ew::VertexFormat::FLOAT)) {
+				checkInstance(program, packedMesh, meshData, palette + first, first, model, viewProjection);
+			}
+		}
+		glDeleteProgram(program);
+	}
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return test::testResult();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+
+//Minimal checks for the test executables. A failed check prints where it failed and
+//testResult() turns the count into the process exit code CTest reads.
+namespace test {
+	inline int& failures() {
+		static int count = 0;
+		return count;
+	}
+
+	inline bool check(bool condition, const char* expression, const char* file, int line) {
+		if (!condition) {
+			printf("%s:%d: CHECK(%s) failed\n", file, line, expression);
+			failures()++;
+		}
+		return condition;
+	}
+
+	inline bool checkNear(double a, double b, double tolerance, const char* expression, const char* file, int line) {
+		bool near = std::fabs(a - b) <= tolerance;
+		if (!near) {
+			printf("%s:%d: CHECK_NEAR(%s) failed, %g vs %g (tolerance %g)\n", file, line, expression, a, b, tolerance);
+			failures()++;
+		}
+		return near;
+	}
+
+	//0 if every check passed
+	inline int testResult() {
+		if (failures() > 0) {
+			printf("%d check(s) failed\n", failures());
+			return 1;
+		}
+		printf("All checks passed\n");
+		return 0;
+	}
+}
+
+#define CHECK(condition) test::check((condition), #condition, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tolerance) test::checkNear((a), (b), (tolerance), #a ", " #b, __FILE__, __LINE__)
+//Exit code that CTest reports as skipped, for tests that need hardware the machine lacks
+#define TEST_SKIPPED 77
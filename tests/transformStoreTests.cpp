@@ -0,0 +1,130 @@
+#include <ew/transformStore.h>
+#include "test.h"
+#include <random>
+#include <vector>
+
+//TransformStore's SIMD matrices against composeTRS, and its storage through removeSwap and growth
+
+static std::mt19937 rng(99);
+
+static float randomFloat(float min, float max) {
+	return std::uniform_real_distribution<float>(min, max)(rng);
+}
+
+static ew::Transform randomTransform() {
+	ew::Transform transform;
+	transform.position = glm::vec3(randomFloat(-50, 50), randomFloat(-50, 50), randomFloat(-50, 50));
+	transform.rotation = glm::normalize(glm::quat(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1)));
+	transform.scale = glm::vec3(randomFloat(0.1f, 3), randomFloat(0.1f, 3), randomFloat(0.1f, 3));
+	return transform;
+}
+
+static bool sameTransform(const ew::Transform& a, const ew::Transform& b) {
+	return a.position == b.position && a.scale == b.scale
+		&& a.rotation.x == b.rotation.x && a.rotation.y == b.rotation.y && a.rotation.z == b.rotation.z && a.rotation.w == b.rotation.w;
+}
+
+//out[i] equals composeTRS of transform i, for i in [begin, end)
+static bool matchesComposeTRS(const std::vector<ew::Transform>& transforms, const std::vector<glm::mat4>& out, int begin, int end) {
+	for (int i = begin; i < end; i++) {
+		glm::mat4 expected = ew::composeTRS(transforms[i].position, transforms[i].rotation, transforms[i].scale);
+		for (int c = 0; c < 4; c++) {
+			for (int r = 0; r < 4; r++) {
+				//same operations in the same order, only contraction into FMA can differ
+				if (!CHECK_NEAR(out[i][c][r], expected[c][r], 1e-5 * (1.0 + std::fabs(expected[c][r])))) {
+					printf("  transform %d of %d, column %d row %d\n", i, (int)transforms.size(), c, r);
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+//Sizes around the SIMD width, and one just past a batch so the async version has a tail batch
+static void testMatrices(ew::JobSystem& jobs) {
+	const int sizes[] = { 1, 7, 8, 9, ew::TransformStore::BATCH_SIZE + 1 };
+	const glm::mat4 untouched(-1.0f);
+	for (int size : sizes) {
+		std::vector<ew::Transform> transforms(size);
+		ew::TransformStore store;
+		for (int i = 0; i < size; i++) {
+			transforms[i] = randomTransform();
+			store.add(transforms[i]);
+		}
+
+		std::vector<glm::mat4> out(size, untouched);
+		store.computeModelMatrices(out.data());
+		if (!matchesComposeTRS(transforms, out, 0, size)) {
+			printf("  computeModelMatrices\n");
+		}
+
+		out.assign(size, untouched);
+		jobs.wait(store.computeModelMatricesAsync(jobs, out.data(), 64));
+		if (!matchesComposeTRS(transforms, out, 0, size)) {
+			printf("  computeModelMatricesAsync\n");
+		}
+
+		//a range that starts and ends off the SIMD width leaves the rest alone
+		if (size > 4) {
+			int begin = 1;
+			int end = size - 2;
+			out.assign(size, untouched);
+			store.computeModelMatrices(out.data(), begin, end);
+			if (!matchesComposeTRS(transforms, out, begin, end)) {
+				printf("  computeModelMatrices [%d, %d)\n", begin, end);
+			}
+			CHECK(out[0] == untouched);
+			CHECK(out[size - 1] == untouched && out[size - 2] == untouched);
+		}
+	}
+}
+
+//removeSwap moves the last transform into the hole, reserve keeps everything that was stored
+static void testStorage() {
+	std::vector<ew::Transform> expected;
+	ew::TransformStore store(3);
+	CHECK(store.capacity() >= 3 && store.capacity() % 8 == 0);
+	//grows from 8 several times
+	for (int i = 0; i < 300; i++) {
+		expected.push_back(randomTransform());
+		CHECK(store.add(expected.back()) == i);
+	}
+	CHECK(store.size() == 300);
+	CHECK(store.capacity() >= 300);
+
+	//middle, first and last
+	const int removals[] = { 123, 0, 297 };
+	for (int index : removals) {
+		int last = (int)expected.size() - 1;
+		CHECK(store.removeSwap(index) == last);
+		expected[index] = expected[last];
+		expected.pop_back();
+	}
+	store.reserve(store.capacity() * 4);
+	CHECK(store.size() == (int)expected.size());
+
+	for (int i = 0; i < store.size(); i++) {
+		if (!CHECK(sameTransform(store.get(i), expected[i]))) {
+			printf("  transform %d\n", i);
+			return;
+		}
+	}
+	//channels agree with get()
+	const float* y = store.channel(ew::TransformStore::POSITION_Y);
+	const float* w = store.channel(ew::TransformStore::ROTATION_W);
+	for (int i = 0; i < store.size(); i++) {
+		CHECK(y[i] == expected[i].position.y && w[i] == expected[i].rotation.w);
+	}
+	//the store's matrices follow the edits too
+	std::vector<glm::mat4> out(store.size());
+	store.computeModelMatrices(out.data());
+	matchesComposeTRS(expected, out, 0, store.size());
+}
+
+int main() {
+	ew::JobSystem jobs(3);
+	testMatrices(jobs);
+	testStorage();
+	return test::testResult();
+}
@@ -0,0 +1,116 @@
+#include <ew/transform.h>
+#include "test.h"
+#include <random>
+
+//CachedTransform against composeTRS on the same fields, after writes in every order
+
+static std::mt19937 rng(4242);
+
+static float randomFloat(float min, float max) {
+	return std::uniform_real_distribution<float>(min, max)(rng);
+}
+
+static glm::vec3 randomVec3(float min, float max) {
+	return glm::vec3(randomFloat(min, max), randomFloat(min, max), randomFloat(min, max));
+}
+
+static bool sameMatrix(const glm::mat4& a, const glm::mat4& b) {
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 4; r++) {
+			if (a[c][r] != b[c][r]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//Each read must equal the uncached Transform result exactly, the cache stores composeTRS of the same inputs
+static bool matchesUncached(const ew::CachedTransform& cached, int read) {
+	const ew::Transform& plain = cached;
+	bool ok = true;
+	switch (read) {
+	case 0:
+		ok = CHECK(sameMatrix(cached.modelMatrix(), plain.modelMatrix()));
+		break;
+	case 1:
+		ok = CHECK(sameMatrix(cached.modelMatrixEuler(), plain.modelMatrixEuler()));
+		break;
+	default:
+		glm::quat expected = glm::quat(plain.rotEuler);
+		glm::quat actual = cached.eulerRotation();
+		ok = CHECK(actual.x == expected.x && actual.y == expected.y && actual.z == expected.z && actual.w == expected.w);
+		break;
+	}
+	return ok;
+}
+
+//Random single field writes, each followed by one to three random reads
+static void testRandomWrites() {
+	ew::CachedTransform transform;
+	for (int step = 0; step < 2000; step++) {
+		switch (rng() % 5) {
+		case 0:
+			transform.position = randomVec3(-5, 5);
+			break;
+		case 1:
+			transform.rotation = glm::normalize(glm::quat(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1)));
+			break;
+		case 2:
+			transform.rotEuler = randomVec3(-3, 3);
+			break;
+		case 3:
+			transform.scale = randomVec3(0.5f, 2);
+			break;
+		default:
+			//one component only, the cache must compare all of them
+			transform.rotEuler.z += 0.25f;
+			break;
+		}
+		int reads = 1 + rng() % 3;
+		for (int i = 0; i < reads; i++) {
+			if (!matchesUncached(transform, rng() % 3)) {
+				printf("  step %d\n", step);
+				return;
+			}
+		}
+	}
+}
+
+//The cache that was removed shared one Euler input between eulerRotation() and modelMatrixEuler(),
+//so reading the rotation after a change left the Euler matrix stale
+static void testEulerReadOrder() {
+	ew::CachedTransform transform;
+	transform.rotEuler = glm::vec3(0.1f, 0.2f, 0.3f);
+	matchesUncached(transform, 1);
+	transform.rotEuler = glm::vec3(1.0f, -0.5f, 0.25f);
+	matchesUncached(transform, 2);
+	matchesUncached(transform, 1);
+	//and the quaternion matrix is unaffected by Euler reads
+	transform.rotation = glm::quat(glm::vec3(0.5f, 0.0f, 0.0f));
+	matchesUncached(transform, 1);
+	matchesUncached(transform, 0);
+}
+
+//Copies carry the cache, which stays keyed on the copy's own fields
+static void testCopy() {
+	ew::CachedTransform a;
+	a.position = glm::vec3(1, 2, 3);
+	a.rotEuler = glm::vec3(0.3f, 0.2f, 0.1f);
+	a.modelMatrix();
+	a.modelMatrixEuler();
+	ew::CachedTransform b = a;
+	b.position.y = -2;
+	b.rotEuler.x = 0.0f;
+	for (int read = 0; read < 3; read++) {
+		matchesUncached(a, read);
+		matchesUncached(b, read);
+	}
+}
+
+int main() {
+	testRandomWrites();
+	testEulerReadOrder();
+	testCopy();
+	return test::testResult();
+}